@@ -0,0 +1,188 @@
+#include "Command_Interpreter.h"
+#include "Serial_Writer.h"
+#include "Thrust_Mixer.h"
+#include "Wiring.h"
+#include <benchmark/benchmark.h>
+#include <array>
+#include <fstream>
+#include <streambuf>
+#include <thread>
+#include <unistd.h>
+
+/*
+ * Microbenchmarks for the interpreter and wiring layers. Every benchmark writes to an in-memory sink, so no Pico is
+ * needed. Run with --benchmark_format=json (or --benchmark_out=results.json) to get results that can be compared between
+ * releases, e.g. with compare.py from the Google Benchmark repo.
+ */
+
+namespace {
+    /// @brief One thruster per GPIO, from GPIO 0 up
+    std::array<int, THRUSTER_COUNT> makeThrusterPins() {
+        std::array<int, THRUSTER_COUNT> pins{};
+        for (int i = 0; i < THRUSTER_COUNT; i++) {
+            pins[i] = i;
+        }
+        return pins;
+    }
+
+    const std::array<int, THRUSTER_COUNT> THRUSTER_PINS = makeThrusterPins();
+
+    /// @brief Every thruster at the same pulse width
+    pwm_array uniformPwms(int pwm) {
+        pwm_array pwms{};
+        for (int &value: pwms.pwm_signals) {
+            value = pwm;
+        }
+        return pwms;
+    }
+
+    /// @brief Discards everything written to it, so benchmarks measure encoding rather than stream buffering
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+
+        std::streamsize xsputn(const char *, std::streamsize count) override { return count; }
+    };
+
+    NullBuffer nullBuffer;
+    std::ostream nullStream(&nullBuffer);
+
+    /// @brief A WiringControl with the thruster pins configured, writing into nothing
+    WiringControl makeWiringControl(WireProtocol protocol) {
+        WiringControl wiringControl(nullStream, nullStream, nullStream);
+        for (int pin: THRUSTER_PINS) {
+            wiringControl.setPinType(pin, HardwarePWM);
+        }
+        wiringControl.setWireProtocol(protocol);
+        return wiringControl;
+    }
+
+    /// @brief An interpreter driving the thruster pins. The pins are configured up front so that no serial port is opened.
+    struct InterpreterFixture {
+        WiringControl wiringControl;
+        Command_Interpreter_RPi5 interpreter;
+
+        explicit InterpreterFixture(WireProtocol protocol) : wiringControl(makeWiringControl(protocol)),
+                                                             interpreter(makePins(), std::vector<DigitalPin *>{},
+                                                                         wiringControl, nullStream, nullStream,
+                                                                         nullStream) {}
+
+        static std::vector<PwmPin *> makePins() {
+            std::vector<PwmPin *> pins;
+            for (int pin: THRUSTER_PINS) {
+                pins.push_back(new HardwarePwmPin(pin, nullStream, nullStream, nullStream));
+            }
+            return pins;
+        }
+    };
+}
+
+static void BM_UntimedExecute(benchmark::State &state) {
+    InterpreterFixture fixture((WireProtocol) state.range(0));
+    pwm_array pwms = uniformPwms(1500);
+    int step = 0;
+    for (auto _: state) {
+        for (int &pwm: pwms.pwm_signals) {
+            pwm = 1100 + (step++ % 800);
+        }
+        fixture.interpreter.untimed_execute(pwms);
+    }
+    state.SetItemsProcessed(state.iterations() * THRUSTER_COUNT);
+}
+BENCHMARK(BM_UntimedExecute)->Arg(AsciiProtocol)->Arg(BinaryProtocol);
+
+static void BM_BlindExecuteAccuracy(benchmark::State &state) {
+    InterpreterFixture fixture(BinaryProtocol);
+    // Half the thrusters forwards and half in reverse
+    pwm_array pwms = uniformPwms(1600);
+    for (int i = THRUSTER_COUNT / 2; i < THRUSTER_COUNT; i++) {
+        pwms.pwm_signals[i] = 1400;
+    }
+    CommandComponent command = {pwms, std::chrono::milliseconds(state.range(0))};
+    for (auto _: state) {
+        fixture.interpreter.blind_execute(command);
+    }
+    WaitStatistics statistics = fixture.interpreter.getWaitStatistics();
+    state.counters["mean_overshoot_ns"] = (double) statistics.meanOvershoot().count();
+    state.counters["max_overshoot_ns"] = (double) statistics.maxOvershoot.count();
+}
+BENCHMARK(BM_BlindExecuteAccuracy)->Arg(1)->Arg(10)->Unit(benchmark::kMillisecond);
+
+static void BM_PwmWrite(benchmark::State &state) {
+    WiringControl wiringControl = makeWiringControl((WireProtocol) state.range(0));
+    int step = 0;
+    for (auto _: state) {
+        wiringControl.pwmWrite(THRUSTER_PINS[0], 1100 + (step++ % 800));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PwmWrite)->Arg(AsciiProtocol)->Arg(BinaryProtocol);
+
+static void BM_SetPinType(benchmark::State &state) {
+    WiringControl wiringControl = makeWiringControl((WireProtocol) state.range(0));
+    for (auto _: state) {
+        wiringControl.setPinType(THRUSTER_PINS[0], HardwarePWM);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SetPinType)->Arg(AsciiProtocol)->Arg(BinaryProtocol);
+
+static void BM_ReadPins(benchmark::State &state) {
+    InterpreterFixture fixture(AsciiProtocol);
+    std::vector<int> values;
+    for (auto _: state) {
+        fixture.interpreter.readPins(values);
+        benchmark::DoNotOptimize(values.data());
+    }
+}
+BENCHMARK(BM_ReadPins);
+
+static void BM_ThrustMix(benchmark::State &state) {
+    float allocationMatrix[MIXER_THRUSTER_COUNT][WRENCH_AXES] = {};
+    for (int thruster = 0; thruster < MIXER_THRUSTER_COUNT; thruster++) {
+        for (int axis = 0; axis < WRENCH_AXES; axis++) {
+            allocationMatrix[thruster][axis] = (float) ((thruster + axis) % 3) * 0.25f - 0.25f;
+        }
+    }
+    ThrustMixer mixer(allocationMatrix, ThrustCurve::t200());
+    Wrench wrench = {{20, -5, 10, 1, -2, 3}};
+    for (auto _: state) {
+        benchmark::DoNotOptimize(wrench);
+        pwm_array pwms = mixer.mix(wrench);
+        benchmark::DoNotOptimize(pwms);
+    }
+}
+BENCHMARK(BM_ThrustMix);
+
+static void BM_SerialWriterThroughput(benchmark::State &state) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        state.SkipWithError("Could not create a pipe");
+        return;
+    }
+    // Drain the pipe as fast as possible, standing in for the serial device
+    std::thread drain([fd = fds[0]]() {
+        char buffer[65536];
+        while (read(fd, buffer, sizeof(buffer)) > 0) {}
+    });
+    const std::size_t frameSize = (std::size_t) state.range(0);
+    std::vector<char> frame(frameSize, 'x');
+    {
+        SerialWriter writer(fds[1], 1024, nullStream);
+        for (auto _: state) {
+            while (!writer.enqueue(frame.data(), frame.size())) {
+                std::this_thread::yield();
+            }
+        }
+        writer.flush(std::chrono::seconds(5));
+        state.counters["full_queue_retries"] = (double) writer.getStatistics().overflows;
+    }
+    close(fds[1]);
+    drain.join();
+    close(fds[0]);
+    state.SetBytesProcessed(state.iterations() * (int64_t) frameSize);
+}
+// The writer thread does the actual work, so measure wall time rather than the producer's CPU time
+BENCHMARK(BM_SerialWriterThroughput)->Arg(21)->Arg(128)->Arg(1024)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,138 @@
+#include "Ack_Window.h"
+
+#include <algorithm>
+
+void AckWindow::enable(std::size_t size, std::chrono::milliseconds ackTimeout) {
+    std::lock_guard<std::mutex> lock(mutex);
+    frames.fill(Outstanding{});
+    enabled = true;
+    windowSize = std::max<std::size_t>(1, std::min(size, ACK_WINDOW_MAX_SIZE));
+    timeout = ackTimeout;
+    outstanding = 0;
+    oldestSequence = nextSequence;
+    recoveryNeeded = false;
+}
+
+void AckWindow::disable() {
+    std::lock_guard<std::mutex> lock(mutex);
+    enabled = false;
+    frames.fill(Outstanding{});
+    outstanding = 0;
+    roomCondition.notify_all();
+}
+
+bool AckWindow::isEnabled() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return enabled;
+}
+
+bool AckWindow::waitForRoom() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (outstanding < windowSize) {
+        return true;
+    }
+    statistics.stalls++;
+    return roomCondition.wait_for(lock, timeout, [this]() { return outstanding < windowSize; });
+}
+
+uint8_t AckWindow::send(MonotonicClock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint8_t sequence = nextSequence++;
+    if (outstanding == windowSize) {
+        // The caller did not wait for room: give up on the oldest frame
+        for (; !frames[oldestSequence].active; oldestSequence++) {}
+        statistics.timedOut++;
+        recoveryNeeded = true;
+        retire(oldestSequence);
+    }
+    frames[sequence].active = true;
+    frames[sequence].sentAt = now;
+    if (outstanding == 0) {
+        oldestSequence = sequence;
+    }
+    outstanding++;
+    statistics.sent++;
+    return sequence;
+}
+
+void AckWindow::retire(uint8_t sequence) {
+    frames[sequence].active = false;
+    outstanding--;
+    while (outstanding > 0 && !frames[oldestSequence].active) {
+        oldestSequence++;
+    }
+    roomCondition.notify_all();
+}
+
+bool AckWindow::acknowledge(uint8_t sequence, MonotonicClock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!enabled || !frames[sequence].active) {
+        statistics.unmatchedAcks++;
+        return false;
+    }
+    auto roundTrip = std::chrono::duration_cast<std::chrono::nanoseconds>(now - frames[sequence].sentAt);
+    statistics.lastRoundTrip = roundTrip;
+    statistics.maxRoundTrip = std::max(statistics.maxRoundTrip, roundTrip);
+    if (statistics.acknowledged == 0) {
+        statistics.smoothedRoundTrip = roundTrip;
+    } else {
+        statistics.smoothedRoundTrip += (roundTrip - statistics.smoothedRoundTrip) / 8;
+    }
+    statistics.acknowledged++;
+    retire(sequence);
+    return true;
+}
+
+int AckWindow::expire(MonotonicClock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return expireLocked(now);
+}
+
+int AckWindow::expireLocked(MonotonicClock::time_point now) {
+    int expired = 0;
+    // Frames are sent in order, so only the oldest can be the first to time out
+    while (outstanding > 0 && now - frames[oldestSequence].sentAt > timeout) {
+        retire(oldestSequence);
+        expired++;
+    }
+    if (expired > 0) {
+        statistics.timedOut += expired;
+        recoveryNeeded = true;
+    }
+    return expired;
+}
+
+bool AckWindow::takeRecoveryRequest() {
+    std::lock_guard<std::mutex> lock(mutex);
+    bool needed = recoveryNeeded;
+    recoveryNeeded = false;
+    return needed;
+}
+
+bool AckWindow::waitForAll(std::chrono::milliseconds waitTimeout) {
+    auto deadline = MonotonicClock::now() + waitTimeout;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        auto now = MonotonicClock::now();
+        expireLocked(now);
+        if (outstanding == 0) {
+            return true;
+        }
+        if (now >= deadline) {
+            return false;
+        }
+        // Wake for an ack, or when the oldest frame's ack is overdue
+        auto oldestDeadline = frames[oldestSequence].sentAt + timeout + std::chrono::nanoseconds(1);
+        roomCondition.wait_until(lock, std::min(deadline, oldestDeadline));
+    }
+}
+
+std::size_t AckWindow::getOutstandingCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return outstanding;
+}
+
+AckStatistics AckWindow::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
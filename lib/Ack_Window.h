@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Timing.h"
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/// @brief Largest number of unacknowledged frames. Half the sequence number space, so that a late ack can never be
+/// mistaken for an ack of a newer frame with the same number.
+const std::size_t ACK_WINDOW_MAX_SIZE = 128;
+
+/// @brief Delivery and round-trip counters of an ack window
+struct AckStatistics {
+    long sent = 0;
+    long acknowledged = 0;
+    /// @brief Frames that were not acknowledged in time
+    long timedOut = 0;
+    /// @brief Acks that did not match an outstanding frame (duplicates, or acks arriving after their frame timed out)
+    long unmatchedAcks = 0;
+    /// @brief How many times a send had to wait for room in the window
+    long stalls = 0;
+    std::chrono::nanoseconds lastRoundTrip{0};
+    /// @brief Exponentially smoothed round-trip time (weight 1/8 per sample, as in TCP)
+    std::chrono::nanoseconds smoothedRoundTrip{0};
+    std::chrono::nanoseconds maxRoundTrip{0};
+};
+
+/// @brief Tracks frames sent to the Pico that have not been acknowledged yet. Each frame gets an 8-bit sequence number;
+/// at most windowSize frames may be outstanding at once. Frames that are not acknowledged within the timeout are
+/// counted as lost and flag that a recovery is needed. Safe to use from a sending thread and a receiving thread at once.
+class AckWindow {
+private:
+    struct Outstanding {
+        bool active = false;
+        MonotonicClock::time_point sentAt;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable roomCondition;
+    std::array<Outstanding, 256> frames{};
+    bool enabled = false;
+    std::size_t windowSize = 8;
+    std::chrono::milliseconds timeout{50};
+    std::size_t outstanding = 0;
+    uint8_t nextSequence = 0;
+    uint8_t oldestSequence = 0;
+    bool recoveryNeeded = false;
+    AckStatistics statistics;
+
+    /// @brief Stop tracking a frame. The mutex must be held.
+    void retire(uint8_t sequence);
+
+    /// @brief expire() with the mutex already held
+    int expireLocked(MonotonicClock::time_point now);
+
+public:
+    /// @brief Start tracking frames, forgetting anything tracked before
+    /// @param windowSize how many frames may be unacknowledged at once, between 1 and ACK_WINDOW_MAX_SIZE
+    /// @param timeout how long to wait for an ack before the frame counts as lost
+    void enable(std::size_t windowSize, std::chrono::milliseconds timeout);
+
+    /// @brief Stop tracking frames
+    void disable();
+
+    bool isEnabled() const;
+
+    /// @brief Wait until another frame may be sent
+    /// @return False if the window was still full after the timeout
+    bool waitForRoom();
+
+    /// @brief Track a new frame
+    /// @param now when the frame is sent
+    /// @return The frame's sequence number
+    uint8_t send(MonotonicClock::time_point now);
+
+    /// @brief Handle an ack from the Pico
+    /// @param sequence the acknowledged sequence number
+    /// @param now when the ack arrived
+    /// @return True if the ack matched an outstanding frame
+    bool acknowledge(uint8_t sequence, MonotonicClock::time_point now);
+
+    /// @brief Count every frame sent more than the timeout before now as lost
+    /// @return The number of frames that timed out
+    int expire(MonotonicClock::time_point now);
+
+    /// @brief Whether a frame has been lost since the last call. Clears the flag.
+    bool takeRecoveryRequest();
+
+    /// @brief Wait until every outstanding frame is acknowledged or has timed out. Frames that time out while waiting
+    /// are expired (and flag a recovery) as their deadlines pass, so the wait never outlasts the ack timeout needlessly.
+    /// @param timeout the longest time to wait
+    /// @return True if no frames are outstanding
+    bool waitForAll(std::chrono::milliseconds timeout);
+
+    /// @brief Number of frames waiting for an ack
+    std::size_t getOutstandingCount() const;
+
+    AckStatistics getStatistics() const;
+};
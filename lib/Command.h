@@ -7,11 +7,20 @@
 
 enum Direction {Forwards, Backwards};
 
+// The number of thrusters is fixed when the code is built, so commands stay plain fixed-size values.
+// Build with -DPROPULSION_THRUSTER_COUNT=n (the THRUSTER_COUNT CMake cache variable) for other vehicles.
+#ifndef PROPULSION_THRUSTER_COUNT
+#define PROPULSION_THRUSTER_COUNT 8
+#endif
+
+/// @brief Number of thrusters on the vehicle: the length of every force_array and pwm_array
+const int THRUSTER_COUNT = PROPULSION_THRUSTER_COUNT;
+
 struct force_array{
-	float forces[8];
+	float forces[THRUSTER_COUNT];
 };
 struct pwm_array {
-    int pwm_signals[8];
+    int pwm_signals[THRUSTER_COUNT];
 };
 
 struct CommandComponent {
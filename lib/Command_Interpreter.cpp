@@ -1,10 +1,10 @@
 // William Barber
 #include <iostream>
 #include <fstream>
-#include <ctime>
 #include <utility>
 #include "Serial.h"
 #include "Command_Interpreter.h"
+#include "Trace.h"
 #include "Wiring.h"
 
 void DigitalPin::initialize(WiringControl &wiringControl) {
@@ -66,10 +66,12 @@ int DigitalPin::read(WiringControl &wiringControl) {
 }
 
 void PwmPin::setPwm(int pulseWidth, WiringControl &wiringControl) {
+    TRACE_SPAN("PwmPin::setPwm");
     setPowerAndDirection(pulseWidth, wiringControl);
-    std::time_t currentTime = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-    outLog << "Current time: " << std::ctime(&currentTime) << std::endl;
-    outLog << "Thruster at pin " << gpioNumber << ": " << pulseWidth << std::endl;
+    // With an event log attached, WiringControl has already recorded the write with a timestamp
+    if (wiringControl.getEventLog() == nullptr) {
+        outLog << "Thruster at pin " << gpioNumber << ": " << pulseWidth << '\n';
+    }
 }
 
 
@@ -127,35 +129,47 @@ Command_Interpreter_RPi5::Command_Interpreter_RPi5(std::vector<PwmPin *> thruste
                                                    const WiringControl &wiringControl, std::ostream &output,
                                                    std::ostream &outLog, std::ostream &errorLog) :
         thrusterPins(std::move(thrusterPins)), digitalPins(std::move(digitalPins)), wiringControl(wiringControl),
-        errorLog(errorLog), outLog(outLog), output(output), isInterruptBlind_Execute(false) {
-    if (this->thrusterPins.size() != 8) {
-        errorLog << "Incorrect number of thruster pwm pins given! Need 8, given " << this->thrusterPins.size()
+        errorLog(errorLog), outLog(outLog), output(output), waitStrategy(new HybridWaitStrategy()) {
+    if (this->thrusterPins.size() != THRUSTER_COUNT) {
+        errorLog << "Incorrect number of thruster pwm pins given! Need " << THRUSTER_COUNT << ", given "
+                 << this->thrusterPins.size()
                  << std::endl;
         exit(42);
     }
+    pins.insert(pins.end(), this->thrusterPins.begin(), this->thrusterPins.end());
+    pins.insert(pins.end(), this->digitalPins.begin(), this->digitalPins.end());
 }
 
-std::vector<Pin *> Command_Interpreter_RPi5::allPins() {
-    auto allPins = std::vector<Pin *>{};
-    allPins.insert(allPins.end(), this->thrusterPins.begin(), this->thrusterPins.end());
-    allPins.insert(allPins.end(), this->digitalPins.begin(), this->digitalPins.end());
-    return allPins;
-}
-
-void Command_Interpreter_RPi5::initializePins() {
+bool Command_Interpreter_RPi5::initializePins() {
     if (!wiringControl.initializeSerial()) {
         errorLog << "Failure to configure serial!" << std::endl;
-        exit(42);
+        return false;
     }
+    wiringControl.beginFrame();
     for (Pin *pin: allPins()) {
         pin->initialize(wiringControl);
     }
+    wiringControl.endFrame();
+    return true;
 }
 
 std::vector<int> Command_Interpreter_RPi5::readPins() {
     std::vector<int> pinValues;
-    for (auto pin: allPins()) {
-        pinValues.push_back(pin->read(wiringControl));
+    readPins(pinValues);
+    return pinValues;
+}
+
+void Command_Interpreter_RPi5::readPins(std::vector<int> &pinValues) {
+    pinValues.resize(allPins().size());
+    for (std::size_t i = 0; i < allPins().size(); i++) {
+        pinValues[i] = allPins()[i]->read(wiringControl);
+    }
+}
+
+std::array<int, THRUSTER_COUNT> Command_Interpreter_RPi5::readThrusterPins() {
+    std::array<int, THRUSTER_COUNT> pinValues{};
+    for (std::size_t i = 0; i < pinValues.size(); i++) {
+        pinValues[i] = thrusterPins[i]->read(wiringControl);
     }
     return pinValues;
 }
@@ -167,27 +181,223 @@ Command_Interpreter_RPi5::~Command_Interpreter_RPi5() {
 }
 
 void Command_Interpreter_RPi5::blind_execute(const CommandComponent &commandComponent) {
-    isInterruptBlind_Execute = false;
-    auto endTime = std::chrono::system_clock::now() + commandComponent.duration;
-    auto currentTime = std::chrono::system_clock::now();
-    untimed_execute(commandComponent.thruster_pwms);
-    while (currentTime < endTime && !isInterruptBlind_Execute) {
-        currentTime = std::chrono::system_clock::now();
+    TRACE_SPAN("Command_Interpreter_RPi5::blind_execute");
+    std::lock_guard<std::mutex> lock(executionMutex);
+    cancellation.reset();
+    if (handleEmergencyStop()) {
+        return;
+    }
+    auto endTime = MonotonicClock::now() + commandComponent.duration;
+    sendThrusterPwms(commandComponent.thruster_pwms.pwm_signals);
+    if (!waitStrategy->wait(endTime, cancellation)) {
+        handleEmergencyStop();
+    }
+    cancellation.reset();
+}
+
+SequenceReport Command_Interpreter_RPi5::execute(const Sequence &sequence) {
+    TRACE_SPAN("Command_Interpreter_RPi5::execute");
+    struct ScheduledPhase {
+        const CommandComponent *component;
+        std::size_t commandIndex;
+        CommandPhase phase;
+        std::chrono::nanoseconds start;
+    };
+
+    std::vector<ScheduledPhase> timeline;
+    timeline.reserve(sequence.commands.size() * 3);
+    std::chrono::nanoseconds offset(0);
+    for (std::size_t i = 0; i < sequence.commands.size(); i++) {
+        const Command &command = sequence.commands[i];
+        const CommandComponent *components[3] = {&command.acceleration, &command.steadyState, &command.deceleration};
+        for (int phase = AccelerationPhase; phase <= DecelerationPhase; phase++) {
+            if (components[phase]->duration.count() <= 0) {
+                continue;
+            }
+            timeline.push_back(ScheduledPhase{components[phase], i, (CommandPhase) phase, offset});
+            offset += components[phase]->duration;
+        }
+    }
+
+    SequenceReport report;
+    report.scheduledDuration = offset;
+    report.phases.reserve(timeline.size());
+
+    std::lock_guard<std::mutex> lock(executionMutex);
+    cancellation.reset();
+    if (handleEmergencyStop()) {
+        report.interrupted = true;
+        return report;
+    }
+    auto startTime = MonotonicClock::now();
+    for (std::size_t i = 0; i < timeline.size(); i++) {
+        const ScheduledPhase &scheduled = timeline[i];
+        auto actualStart = MonotonicClock::now() - startTime;
+        sendThrusterPwms(scheduled.component->thruster_pwms.pwm_signals);
+        report.phases.push_back(PhaseTiming{scheduled.commandIndex, scheduled.phase, scheduled.start,
+                                            std::chrono::duration_cast<std::chrono::nanoseconds>(actualStart)});
+
+        auto phaseEnd = startTime + (i + 1 < timeline.size() ? timeline[i + 1].start : offset);
+        if (!waitStrategy->wait(phaseEnd, cancellation)) {
+            report.interrupted = true;
+            handleEmergencyStop();
+            break;
+        }
     }
-    isInterruptBlind_Execute = false;
+    report.actualDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(MonotonicClock::now() - startTime);
+    cancellation.reset();
+    return report;
+}
+
+SequenceReport Command_Interpreter_RPi5::execute(const CompiledSequence &sequence) {
+    TRACE_SPAN("Command_Interpreter_RPi5::execute");
+    SequenceReport report;
+    if (!sequence.isOpen()) {
+        errorLog << "Compiled sequence is not open!" << std::endl;
+        report.interrupted = true;
+        return report;
+    }
+    int pinNumbers[THRUSTER_COUNT];
+    for (std::size_t i = 0; i < thrusterPins.size(); i++) {
+        pinNumbers[i] = thrusterPins[i]->getGpioNumber();
+        if (sequence.header().thrusterPins[i] != pinNumbers[i]) {
+            errorLog << "Compiled sequence was compiled for thruster " << i << " on pin "
+                     << sequence.header().thrusterPins[i] << ", not pin " << pinNumbers[i] << "!" << std::endl;
+            report.interrupted = true;
+            return report;
+        }
+    }
+    report.scheduledDuration = sequence.duration();
+    report.phases.reserve(sequence.phaseCount());
+
+    std::lock_guard<std::mutex> lock(executionMutex);
+    WireProtocol originalProtocol = wiringControl.getWireProtocol();
+    wiringControl.setWireProtocol((WireProtocol) sequence.header().protocol);
+    cancellation.reset();
+    if (handleEmergencyStop()) {
+        wiringControl.setWireProtocol(originalProtocol);
+        report.interrupted = true;
+        return report;
+    }
+    auto startTime = MonotonicClock::now();
+    for (std::size_t i = 0; i < sequence.phaseCount(); i++) {
+        const CompiledPhase &phase = sequence.phase(i);
+        int pulseWidths[THRUSTER_COUNT];
+        for (int pin = 0; pin < THRUSTER_COUNT; pin++) {
+            pulseWidths[pin] = phase.pulseWidths[pin];
+        }
+        auto actualStart = MonotonicClock::now() - startTime;
+        wiringControl.pwmWriteEncoded(sequence.frame(i), phase.frameLength, pinNumbers, pulseWidths, THRUSTER_COUNT);
+        report.phases.push_back(PhaseTiming{phase.commandIndex, (CommandPhase) phase.phase,
+                                            std::chrono::nanoseconds(phase.start),
+                                            std::chrono::duration_cast<std::chrono::nanoseconds>(actualStart)});
+
+        auto phaseEnd = startTime + std::chrono::nanoseconds(
+                i + 1 < sequence.phaseCount() ? sequence.phase(i + 1).start : sequence.header().duration);
+        if (!waitStrategy->wait(phaseEnd, cancellation)) {
+            report.interrupted = true;
+            handleEmergencyStop();
+            break;
+        }
+    }
+    report.actualDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(MonotonicClock::now() - startTime);
+    cancellation.reset();
+    wiringControl.setWireProtocol(originalProtocol);
+    return report;
+}
+
+void Command_Interpreter_RPi5::emergencyStop() {
+    stopRequested = true;
+    cancellation.cancel();
+    // A running command wakes up and handles the stop itself; in that case there is nothing left to do once it has
+    // released the lock
+    std::lock_guard<std::mutex> lock(executionMutex);
+    handleEmergencyStop();
+}
+
+bool Command_Interpreter_RPi5::handleEmergencyStop() {
+    if (!stopRequested.exchange(false)) {
+        return false;
+    }
+    if (wiringControl.getEventLog() != nullptr) {
+        wiringControl.getEventLog()->record(EmergencyStopEvent, 0, 0);
+    }
+    wiringControl.beginFrame();
+    for (PwmPin *pin: thrusterPins) {
+        pin->disable(wiringControl);
+    }
+    wiringControl.endFrame();
+    wiringControl.flushAsyncOutput(std::chrono::milliseconds(100));
+
+    long long latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            MonotonicClock::now() - cancellation.cancelledAt()).count();
+    lastStopLatency = latency;
+    if (latency > maxStopLatency) {
+        maxStopLatency = latency;
+    }
+    stopCount++;
+    return true;
+}
+
+StopStatistics Command_Interpreter_RPi5::getStopStatistics() const {
+    StopStatistics statistics;
+    statistics.stops = stopCount;
+    statistics.lastLatency = std::chrono::nanoseconds(lastStopLatency);
+    statistics.maxLatency = std::chrono::nanoseconds(maxStopLatency);
+    return statistics;
+}
+
+LinkBudgetStatistics Command_Interpreter_RPi5::getLinkBudget() const {
+    return wiringControl.getLinkBudget();
+}
+
+double Command_Interpreter_RPi5::getMaximumUpdateRate() const {
+    int pinsOnFirstLink = 0;
+    for (PwmPin *pin: thrusterPins) {
+        if (pin->getGpioNumber() < PICO_GPIO_COUNT) {
+            pinsOnFirstLink++;
+        }
+    }
+    return maximumFrameRate(wiringControl.getLinkBudget().baud, wiringControl.estimateFrameBytes(pinsOnFirstLink));
+}
+
+void Command_Interpreter_RPi5::setWaitStrategy(std::unique_ptr<WaitStrategy> strategy) {
+    std::lock_guard<std::mutex> executionLock(executionMutex);
+    std::lock_guard<std::mutex> lock(waitStrategyMutex);
+    waitStrategy = std::move(strategy);
+}
+
+WaitStatistics Command_Interpreter_RPi5::getWaitStatistics() const {
+    std::lock_guard<std::mutex> lock(waitStrategyMutex);
+    return waitStrategy->getStatistics();
 }
 
 void Command_Interpreter_RPi5::untimed_execute(pwm_array thrusterPwms) {
-    int i = 0;
-    for (int pulseWidth: thrusterPwms.pwm_signals) {
-        thrusterPins.at(i)->setPwm(pulseWidth, wiringControl);
-        i++;
+    TRACE_SPAN("Command_Interpreter_RPi5::untimed_execute");
+    std::lock_guard<std::mutex> lock(executionMutex);
+    sendThrusterPwms(thrusterPwms.pwm_signals);
+}
+
+bool Command_Interpreter_RPi5::stream_execute(const pwm_array &thrusterPwms, long stopsSeen) {
+    std::lock_guard<std::mutex> lock(executionMutex);
+    if (handleEmergencyStop() || stopCount != stopsSeen) {
+        return false;
     }
+    sendThrusterPwms(thrusterPwms.pwm_signals);
+    return true;
 }
 
-void Command_Interpreter_RPi5::untimed_execute(const std::array<int, 8>& pwms){
-    pwm_array a;
-    std::copy(pwms.begin(), pwms.end(), a.pwm_signals);
-    untimed_execute(a);
+void Command_Interpreter_RPi5::sendThrusterPwms(const int *pulseWidths) {
+    TRACE_SPAN("Command_Interpreter_RPi5::sendThrusterPwms");
+    wiringControl.beginFrame();
+    for (std::size_t i = 0; i < thrusterPins.size(); i++) {
+        thrusterPins[i]->setPwm(pulseWidths[i], wiringControl);
+    }
+    wiringControl.endFrame();
+}
 
+void Command_Interpreter_RPi5::untimed_execute(const std::array<int, THRUSTER_COUNT>& pwms){
+    TRACE_SPAN("Command_Interpreter_RPi5::untimed_execute");
+    std::lock_guard<std::mutex> lock(executionMutex);
+    sendThrusterPwms(pwms.data());
 }
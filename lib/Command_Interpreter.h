@@ -2,7 +2,12 @@
 #pragma once
 
 #include "Command.h"
+#include "Sequence_Compiler.h"
 #include "Wiring.h"
+#include "Timing.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <fstream>
 #include <array>
@@ -13,6 +18,43 @@ enum EnableType {
     ActiveHigh, ActiveLow
 };
 
+/// @brief One of the three parts of a command
+enum CommandPhase {
+    AccelerationPhase, SteadyStatePhase, DecelerationPhase
+};
+
+/// @brief When a phase of a sequence was scheduled to start and when its pwm values were actually sent. Times are
+/// relative to the start of the sequence.
+struct PhaseTiming {
+    std::size_t commandIndex;
+    CommandPhase phase;
+    std::chrono::nanoseconds scheduledStart;
+    std::chrono::nanoseconds actualStart;
+
+    /// @brief How late the phase started
+    std::chrono::nanoseconds lateness() const { return actualStart - scheduledStart; }
+};
+
+/// @brief How the execution of a sequence went
+struct SequenceReport {
+    /// @brief Timing of every phase that was started, in order
+    std::vector<PhaseTiming> phases;
+    /// @brief Whether the sequence was stopped early by interruptBlind_Execute()
+    bool interrupted = false;
+    /// @brief Scheduled length of the whole sequence
+    std::chrono::nanoseconds scheduledDuration{0};
+    /// @brief How long the sequence actually took
+    std::chrono::nanoseconds actualDuration{0};
+};
+
+/// @brief How quickly emergency stops have brought the thrusters to neutral
+struct StopStatistics {
+    long stops = 0;
+    /// @brief Time from emergencyStop() being called until the neutral pwm values were written out
+    std::chrono::nanoseconds lastLatency{0};
+    std::chrono::nanoseconds maxLatency{0};
+};
+
 /*
  * NOTE: We may not need DigitalPin, in which case both DigitalPin and abstract Pin classes are not useful, and can
  * be replaced with just the HardwarePwmPin class (probably renamed to Pin). This would also necessitate the removal of allPins
@@ -44,6 +86,9 @@ public:
     /// @return The current pin status
     virtual int read(WiringControl &wiringControl) = 0;
 
+    /// @brief The Pico GPIO number of the pin
+    int getGpioNumber() const { return gpioNumber; }
+
     /// @param gpioNumber the Pico GPIO number for the pin (see https://pico.pinout.xyz/ and look for GPX labels in green)
     /// @param output where you want output (not logging) messages to be sent (probably std::cout)
     /// @param outLog where you want logging (not error) messages to be logged
@@ -160,16 +205,38 @@ public:
 /// Requires information about wiring, etc.
 class Command_Interpreter_RPi5 {
 private:
-    std::vector<Pin *> allPins();
+    /// @brief Every pin, thrusters first and then digital pins. Built once by the constructor.
+    const std::vector<Pin *> &allPins() const { return pins; }
 
     std::vector<PwmPin *> thrusterPins;
     std::vector<DigitalPin *> digitalPins;
+    std::vector<Pin *> pins;
     WiringControl wiringControl;
     std::ostream &output;
     std::ostream &outLog;
     std::ostream &errorLog;
 
-    bool isInterruptBlind_Execute;
+    CancellationToken cancellation;
+    std::unique_ptr<WaitStrategy> waitStrategy;
+    /// @brief Held while the wait strategy is replaced or its statistics are read. Commands only read the pointer, and
+    /// do so under executionMutex, which setWaitStrategy() also takes.
+    mutable std::mutex waitStrategyMutex;
+
+    /// @brief Held while pwm values are being sent or a command is running, so only one thread talks to the Pico
+    std::mutex executionMutex;
+    std::atomic<bool> stopRequested{false};
+    std::atomic<long> stopCount{0};
+    std::atomic<long long> lastStopLatency{0};
+    std::atomic<long long> maxStopLatency{0};
+
+    /// @brief Send pwm values to every thruster. The caller must hold executionMutex.
+    /// @param pulseWidths one pwm value per thruster, in the same order as thrusterPins
+    void sendThrusterPwms(const int *pulseWidths);
+
+    /// @brief If an emergency stop has been requested, set every thruster to neutral and record how long it took. The
+    /// caller must hold executionMutex.
+    /// @return True if an emergency stop was carried out
+    bool handleEmergencyStop();
 
 public:
     /// @param thrusterPins the PWM pins that will drive robot thrusters
@@ -182,15 +249,19 @@ public:
                                       const WiringControl &wiringControl, std::ostream &output,
                                       std::ostream &outLog, std::ostream &errorLog);
 
-    /// @brief Sends the initialize commands to the Pico
-    void initializePins();
+    /// @brief Sends the initialize commands to the Pico. All pins are configured in a single serial write. Opens the
+    /// serial connection with the default SerialConfig unless it is already open.
+    /// @return False if the serial connection could not be opened
+    bool initializePins();
 
-    /// @brief Executes a command by sending the specified pwm values to the Pico for the specified duration
+    /// @brief Executes a command by sending the specified pwm values to the Pico. All of the thruster values are
+    /// sent together in a single serial write.
     /// @param thrusterPwms a C-style array of pwm frequency integers
     void untimed_execute(pwm_array thrusterPwms);
-    void untimed_execute(const std::array<int, 8>& pwms);
+    void untimed_execute(const std::array<int, THRUSTER_COUNT>& pwms);
     /// @brief Executes a command without self-correction. Sets pwm values for the duration specified. Does not stop
-    /// thrusters after execution.
+    /// thrusters after execution. The duration is measured on the monotonic clock and waited out with the current
+    /// wait strategy.
     /// @param command a command struct with three sub-components: the acceleration, steady-state, and deceleration.
     void blind_execute(const CommandComponent &command);
 
@@ -198,8 +269,70 @@ public:
     /// @return A vector containing the current value of all pins. PWM pins will return a value in the range [1100, 1900]
     std::vector<int> readPins();
 
+    /// @brief Get the current pwm values of all the pins without allocating (once pinValues has grown to fit).
+    /// @param pinValues filled with the current value of all pins, in the same order as readPins()
+    void readPins(std::vector<int> &pinValues);
+
+    /// @brief Get the current pwm values of the thrusters.
+    /// @return The current value of every thruster pin, in the range [1100, 1900]
+    std::array<int, THRUSTER_COUNT> readThrusterPins();
+
+    /// @brief Executes every phase of every command in the sequence back to back. All phase deadlines are computed
+    /// once, relative to the start of the sequence, so timing errors do not accumulate over long sequences. Phases
+    /// with a zero duration are skipped. Does not stop thrusters after execution. Can be stopped early with
+    /// interruptBlind_Execute().
+    /// @param sequence the commands to execute
+    /// @return When each phase started, and whether the sequence was interrupted
+    SequenceReport execute(const Sequence &sequence);
+
+    /// @brief Replays a compiled sequence (see Sequence_Compiler.h) with the same timing as execute(), but sends the
+    /// pre-encoded frames as they are instead of formatting each phase. The sequence must have been compiled for this
+    /// interpreter's thruster pins. The wire protocol is switched to the one it was compiled for while it runs, and
+    /// switched back afterwards.
+    /// Thruster writes are not printed to outLog (attach an event log to record them).
+    /// @param sequence the compiled sequence to replay
+    /// @return When each phase started, and whether the sequence was interrupted. Also counts as interrupted if the
+    /// sequence cannot be replayed on this interpreter.
+    SequenceReport execute(const CompiledSequence &sequence);
+
+    /// @brief Choose how blind_execute waits for the end of a command. Defaults to a HybridWaitStrategy. Waits for a
+    /// running command to finish first.
+    /// @param strategy the wait strategy to use from now on
+    void setWaitStrategy(std::unique_ptr<WaitStrategy> strategy);
+
+    /// @brief How late blind_execute has woken up compared to the requested durations. Safe to call from any thread,
+    /// including while a command is running.
+    /// @return A copy of the overshoot statistics of the current wait strategy
+    WaitStatistics getWaitStatistics() const;
+
     /// @brief Set an interrupt for the blind_execute function while running. Calling this function sets the interrupt to occur.
-    void interruptBlind_Execute() {isInterruptBlind_Execute = true;}
+    /// Safe to call from any thread; a sleeping blind_execute or execute is woken immediately. Thrusters keep their
+    /// current values.
+    void interruptBlind_Execute() { cancellation.cancel(); }
+
+    /// @brief Interrupt any running command and set every thruster to neutral (1500). Safe to call from any thread. If
+    /// a command is running, its own thread writes the neutral values as soon as it wakes; otherwise they are written
+    /// by the calling thread. Returns once the neutral values have been written.
+    void emergencyStop();
+
+    /// @brief How long emergency stops took, from the call to emergencyStop() until the neutral values were written
+    StopStatistics getStopStatistics() const;
+
+    /// @brief How much of the serial link's capacity has been used over the last second
+    LinkBudgetStatistics getLinkBudget() const;
+
+    /// @brief The most thruster updates per second the first serial link can carry at its baud rate, in the current
+    /// protocol (see WiringControl::estimateFrameBytes())
+    /// @return The rate, or 0 if the baud rate is not known
+    double getMaximumUpdateRate() const;
+
+    /// @brief Sends the specified pwm values, unless an emergency stop has happened since the caller last checked.
+    /// Checking and sending happen under the same lock, so a stream of updates from another thread can never
+    /// overwrite the neutral values written by an emergency stop.
+    /// @param thrusterPwms one pwm value per thruster
+    /// @param stopsSeen the number of stops (getStopStatistics().stops) the caller knows about
+    /// @return False if nothing was sent because there has been a newer stop
+    bool stream_execute(const pwm_array &thrusterPwms, long stopsSeen);
 
     ~Command_Interpreter_RPi5(); //TODO this also deletes all its pins. Not sure if this is desirable or not?
 };
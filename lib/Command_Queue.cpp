@@ -0,0 +1,160 @@
+#include "Command_Queue.h"
+
+#include <algorithm>
+
+CommandQueue::CommandQueue(Command_Interpreter_RPi5 &interpreter) : interpreter(interpreter), slots{} {}
+
+void CommandQueue::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) {
+        return;
+    }
+    running = true;
+    // Stops made while the queue was not running should not drop the first submission after it starts
+    stopsSeen = interpreter.getStopStatistics().stops;
+    senderThread = std::thread(&CommandQueue::run, this);
+}
+
+void CommandQueue::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wakeup.notify_all();
+    if (senderThread.joinable()) {
+        senderThread.join();
+    }
+}
+
+void CommandQueue::submit(const pwm_array &pwms, std::chrono::nanoseconds hold, SubmissionPriority priority) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Submission &slot = slots[priority];
+        if (slot.pending) {
+            statistics.superseded++;
+        }
+        slot = Submission{pwms, hold, MonotonicClock::now(), true};
+        statistics.submitted++;
+    }
+    wakeup.notify_one();
+}
+
+void CommandQueue::submit(const pwm_array &pwms, SubmissionPriority priority) {
+    submit(pwms, std::chrono::nanoseconds(0), priority);
+}
+
+void CommandQueue::submit(const CommandComponent &command, SubmissionPriority priority) {
+    submit(command.thruster_pwms, command.duration, priority);
+}
+
+void CommandQueue::submitStop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Submission &slot: slots) {
+            if (slot.pending) {
+                slot.pending = false;
+                statistics.superseded++;
+            }
+        }
+        holdPriority = -1;
+        if (!stopPending) {
+            stopPending = true;
+            stopSubmitted = MonotonicClock::now();
+        }
+    }
+    wakeup.notify_one();
+}
+
+int CommandQueue::nextPriority(MonotonicClock::time_point now) {
+    if (holdPriority != -1 && now >= holdEnd) {
+        holdPriority = -1;
+    }
+    for (int priority = SUBMISSION_PRIORITIES - 1; priority >= 0; priority--) {
+        if (slots[priority].pending && priority >= holdPriority) {
+            return priority;
+        }
+    }
+    return -1;
+}
+
+void CommandQueue::recordLatency(MonotonicClock::time_point submitted, MonotonicClock::time_point sent) {
+    statistics.lastLatency = std::chrono::duration_cast<std::chrono::nanoseconds>(sent - submitted);
+    statistics.maxLatency = std::max(statistics.maxLatency, statistics.lastLatency);
+}
+
+void CommandQueue::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        if (stopPending) {
+            stopPending = false;
+            MonotonicClock::time_point submitted = stopSubmitted;
+            sending = true;
+            lock.unlock();
+            interpreter.emergencyStop();
+            MonotonicClock::time_point sent = MonotonicClock::now();
+            long stops = interpreter.getStopStatistics().stops;
+            lock.lock();
+            sending = false;
+            stopsSeen = stops;
+            statistics.stops++;
+            recordLatency(submitted, sent);
+            continue;
+        }
+
+        int priority = nextPriority(MonotonicClock::now());
+        if (priority == -1) {
+            idle.notify_all();
+            if (holdPriority != -1) {
+                // Something lower is waiting for the hold to end
+                wakeup.wait_until(lock, holdEnd);
+            } else {
+                wakeup.wait(lock);
+            }
+            continue;
+        }
+
+        // Only the newest submission of each priority is ever kept, so whatever is sent here is the latest setpoint
+        Submission submission = slots[priority];
+        slots[priority].pending = false;
+        long stops = stopsSeen;
+        sending = true;
+        lock.unlock();
+        bool sent = interpreter.stream_execute(submission.pwms, stops);
+        MonotonicClock::time_point sentAt = MonotonicClock::now();
+        long stopsNow = sent ? stops : interpreter.getStopStatistics().stops;
+        lock.lock();
+        sending = false;
+        if (sent) {
+            statistics.sent++;
+            recordLatency(submission.submitted, sentAt);
+            if (submission.hold.count() > 0) {
+                holdPriority = priority;
+                holdEnd = sentAt + submission.hold;
+            } else if (priority >= holdPriority) {
+                holdPriority = -1;
+            }
+        } else {
+            // The interpreter was stopped from outside the queue: its neutral values stand until the next submission
+            statistics.dropped++;
+            stopsSeen = stopsNow;
+            holdPriority = -1;
+        }
+    }
+    idle.notify_all();
+}
+
+bool CommandQueue::waitUntilIdle(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return idle.wait_for(lock, timeout, [this]() {
+        return !sending && !stopPending && nextPriority(MonotonicClock::now()) == -1;
+    });
+}
+
+CommandQueueStatistics CommandQueue::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+CommandQueue::~CommandQueue() {
+    stop();
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Command.h"
+#include "Command_Interpreter.h"
+#include "Timing.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/// @brief How urgently a submission should be sent. Each priority keeps only its newest pending submission.
+enum SubmissionPriority {
+    /// @brief Routine setpoints, e.g. from the planner
+    NormalPriority,
+    /// @brief Setpoints that must not be replaced by normal ones while they are held (e.g. a manoeuvre that has to
+    /// finish)
+    HighPriority
+};
+
+/// @brief Number of SubmissionPriority levels
+const int SUBMISSION_PRIORITIES = 2;
+
+/// @brief What has happened to the submissions given to a CommandQueue
+struct CommandQueueStatistics {
+    long submitted = 0;
+    /// @brief Submissions written to the Pico
+    long sent = 0;
+    /// @brief Submissions replaced by a newer one (or cleared by a stop) before they could be sent
+    long superseded = 0;
+    /// @brief Submissions not sent because an emergency stop happened outside the queue first
+    long dropped = 0;
+    /// @brief Stops carried out for submitStop()
+    long stops = 0;
+    /// @brief Time from submission until the values were written out, for the most recent and the slowest submission
+    std::chrono::nanoseconds lastLatency{0};
+    std::chrono::nanoseconds maxLatency{0};
+};
+
+/// @brief Lets a producer hand thruster values to the interpreter without waiting for serial I/O. Submissions return
+/// immediately; a sender thread always sends the newest pending submission of the highest priority and drops the ones
+/// it replaced, so when setpoints arrive faster than the link can carry them the thrusters get the latest one instead
+/// of a growing backlog. A stop preempts everything: it clears every pending submission and ends any hold.
+class CommandQueue {
+private:
+    struct Submission {
+        pwm_array pwms;
+        /// @brief How long the values are held before lower priority submissions may replace them
+        std::chrono::nanoseconds hold;
+        MonotonicClock::time_point submitted;
+        bool pending;
+    };
+
+    Command_Interpreter_RPi5 &interpreter;
+    std::thread senderThread;
+    bool running = false;
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable idle;
+    Submission slots[SUBMISSION_PRIORITIES];
+    bool stopPending = false;
+    MonotonicClock::time_point stopSubmitted;
+    /// @brief Set while the sender is writing without the mutex
+    bool sending = false;
+    /// @brief The priority of the submission being held, or -1 if none is
+    int holdPriority = -1;
+    MonotonicClock::time_point holdEnd;
+    long stopsSeen = 0;
+    CommandQueueStatistics statistics;
+
+    void run();
+
+    /// @brief Add a submission, replacing any pending one of the same priority
+    void submit(const pwm_array &pwms, std::chrono::nanoseconds hold, SubmissionPriority priority);
+
+    /// @brief The priority of the submission to send next, or -1 if there is none that may be sent yet. Ends the hold
+    /// once it has expired. The mutex must be held.
+    int nextPriority(MonotonicClock::time_point now);
+
+    /// @brief Record how long a submission took to be written. The mutex must be held.
+    void recordLatency(MonotonicClock::time_point submitted, MonotonicClock::time_point sent);
+
+public:
+    /// @param interpreter the interpreter whose thrusters are driven. Its pins must already be initialized.
+    explicit CommandQueue(Command_Interpreter_RPi5 &interpreter);
+
+    CommandQueue(const CommandQueue &) = delete;
+
+    CommandQueue &operator=(const CommandQueue &) = delete;
+
+    /// @brief Start sending submissions. Submissions made before this are kept (newest per priority).
+    void start();
+
+    /// @brief Stop sending submissions, after finishing the write in progress. Pending submissions are kept.
+    void stop();
+
+    /// @brief Queue pwm values to be sent as soon as possible, replacing any pending values of the same priority
+    /// @param pwms the pwm values for every thruster
+    /// @param priority normal values are not sent while high priority values are held
+    void submit(const pwm_array &pwms, SubmissionPriority priority = NormalPriority);
+
+    /// @brief Queue a command component: its pwm values are sent as soon as possible and held for its duration, during
+    /// which only submissions of the same or a higher priority replace them. Like blind_execute(), the thrusters keep
+    /// the values afterwards.
+    /// @param command the pwm values and how long to hold them
+    /// @param priority the priority of the command
+    void submit(const CommandComponent &command, SubmissionPriority priority = NormalPriority);
+
+    /// @brief Drop every pending submission and any hold, and have the sender carry out an emergency stop (every
+    /// thruster to neutral) before anything else. Returns without waiting for the stop; call emergencyStop() on the
+    /// interpreter instead to wait for it.
+    void submitStop();
+
+    /// @brief Wait until every pending submission that may be sent has been written (held values may still be
+    /// holding back lower priority submissions)
+    /// @param timeout the longest time to wait
+    /// @return True if the queue became idle in time
+    bool waitUntilIdle(std::chrono::milliseconds timeout);
+
+    CommandQueueStatistics getStatistics() const;
+
+    ~CommandQueue();
+};
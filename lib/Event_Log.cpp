@@ -0,0 +1,86 @@
+#include "Event_Log.h"
+
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+bool readEventLogHeader(std::istream &input, EventLogHeader &header) {
+    char magic[sizeof(EVENT_LOG_MAGIC)];
+    if (!input.read(magic, sizeof(magic)) || std::memcmp(magic, EVENT_LOG_MAGIC, sizeof(magic)) != 0) {
+        return false;
+    }
+    return (bool) input.read(reinterpret_cast<char *>(&header), sizeof(header));
+}
+
+std::string formatEvent(const LogEvent &event, const EventLogHeader &header) {
+    int64_t wallClock = header.wallClockStart + (event.timestamp - header.monotonicStart);
+    std::time_t seconds = (std::time_t) (wallClock / 1000000000);
+    std::tm time{};
+    localtime_r(&seconds, &time);
+
+    std::ostringstream line;
+    line << std::put_time(&time, "%Y-%m-%d %H:%M:%S") << '.' << std::setw(9) << std::setfill('0')
+         << wallClock % 1000000000 << std::setfill(' ') << ' ';
+    switch (event.type) {
+        case ConfigureEvent:
+            line << "Configure pin " << (int) event.pin << ": type " << event.value;
+            break;
+        case DigitalWriteEvent:
+            line << "Digital pin " << (int) event.pin << ": " << (event.value ? "High" : "Low");
+            break;
+        case PwmWriteEvent:
+            line << "Thruster at pin " << (int) event.pin << ": " << event.value;
+            break;
+        case EmergencyStopEvent:
+            line << "Emergency stop";
+            break;
+        default:
+            line << "Unknown event " << (int) event.type;
+    }
+    return line.str();
+}
+
+EventLog::EventLog(std::ostream &sink, std::size_t capacity, std::chrono::milliseconds flushInterval)
+        : sink(sink), flushInterval(flushInterval), events(capacity) {
+    EventLogHeader header{
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count(),
+            std::chrono::duration_cast<std::chrono::nanoseconds>(MonotonicClock::now().time_since_epoch()).count()};
+    sink.write(EVENT_LOG_MAGIC, sizeof(EVENT_LOG_MAGIC));
+    sink.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    writerThread = std::thread(&EventLog::run, this);
+}
+
+void EventLog::run() {
+    while (running.load()) {
+        drain();
+        std::this_thread::sleep_for(flushInterval);
+    }
+    drain();
+}
+
+void EventLog::drain() {
+    long count = 0;
+    LogEvent *event;
+    while ((event = events.front()) != nullptr) {
+        sink.write(reinterpret_cast<const char *>(event), sizeof(LogEvent));
+        events.release();
+        count++;
+    }
+    if (count > 0) {
+        sink.flush();
+        written.fetch_add(count, std::memory_order_release);
+    }
+}
+
+void EventLog::flush() {
+    while (written.load(std::memory_order_acquire) < recorded) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+EventLog::~EventLog() {
+    running.store(false);
+    writerThread.join();
+}
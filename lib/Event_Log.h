@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Ring_Buffer.h"
+#include "Timing.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <thread>
+
+/*
+ * Binary event log format (native byte order, little endian on the Pi):
+ *
+ *     header: "PROPLOG1" | int64 wall clock ns at start | int64 monotonic ns at start
+ *     events: 16 bytes each, see LogEvent
+ *
+ * The two start times let the decoder turn monotonic event timestamps back into wall clock times.
+ */
+
+/// @brief Magic bytes at the start of every event log
+const char EVENT_LOG_MAGIC[8] = {'P', 'R', 'O', 'P', 'L', 'O', 'G', '1'};
+
+/// @brief What a logged event records
+enum EventType : uint8_t {
+    ConfigureEvent = 'C', DigitalWriteEvent = 'D', PwmWriteEvent = 'P', EmergencyStopEvent = 'S'
+};
+
+/// @brief One fixed-size log record
+struct LogEvent {
+    /// @brief Monotonic clock time of the event, in nanoseconds
+    int64_t timestamp;
+    uint8_t type;
+    uint8_t pin;
+    uint16_t reserved;
+    int32_t value;
+};
+
+static_assert(sizeof(LogEvent) == 16, "Log events must stay 16 bytes: the file format depends on it");
+
+/// @brief The start of an event log
+struct EventLogHeader {
+    int64_t wallClockStart;
+    int64_t monotonicStart;
+};
+
+/// @brief Read and check the header at the start of an event log
+/// @param input the log, positioned at its start
+/// @param header where to store the start times
+/// @return False if the input is not an event log
+bool readEventLogHeader(std::istream &input, EventLogHeader &header);
+
+/// @brief Turn an event into one line of text (without a trailing newline)
+/// @param event the event
+/// @param header the header of the log the event came from, used to print wall clock times
+std::string formatEvent(const LogEvent &event, const EventLogHeader &header);
+
+/// @brief Records fixed-size binary events without formatting or blocking. record() only stores 16 bytes into a
+/// lock-free queue; a background thread writes the queued events to the sink in batches. Only one thread at a time may
+/// call record().
+class EventLog {
+private:
+    std::ostream &sink;
+    std::chrono::milliseconds flushInterval;
+    RingBuffer<LogEvent> events;
+    std::thread writerThread;
+    std::atomic<bool> running{true};
+    // Written by the recording thread
+    long recorded = 0;
+    std::atomic<long> dropped{0};
+    // Written by the writer thread
+    std::atomic<long> written{0};
+
+    void run();
+
+    /// @brief Write every queued event to the sink
+    void drain();
+
+public:
+    /// @param sink where the binary log is written, e.g. a std::ofstream opened with std::ios::binary
+    /// @param capacity how many events can be queued before new events are dropped
+    /// @param flushInterval how often the writer thread writes out queued events
+    explicit EventLog(std::ostream &sink, std::size_t capacity = 4096,
+                      std::chrono::milliseconds flushInterval = std::chrono::milliseconds(10));
+
+    EventLog(const EventLog &) = delete;
+
+    EventLog &operator=(const EventLog &) = delete;
+
+    /// @brief Record an event. Never blocks or allocates; if the queue is full the event is dropped and counted.
+    /// @param type what happened
+    /// @param pin the GPIO number involved
+    /// @param value the value written to the pin
+    void record(EventType type, int pin, int value) {
+        LogEvent *event = events.reserve();
+        if (event == nullptr) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        event->timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                MonotonicClock::now().time_since_epoch()).count();
+        event->type = type;
+        event->pin = (uint8_t) pin;
+        event->reserved = 0;
+        event->value = value;
+        events.publish();
+        recorded++;
+    }
+
+    /// @brief Wait until every event recorded so far has been written to the sink. Call from the recording thread.
+    void flush();
+
+    /// @brief Number of events that were recorded (not counting dropped events)
+    long getRecordedCount() const { return recorded; }
+
+    /// @brief Number of events dropped because the queue was full
+    long getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    /// @brief Writes everything still queued, then stops the writer thread
+    ~EventLog();
+};
@@ -0,0 +1,77 @@
+#include "Link_Budget.h"
+
+#include <algorithm>
+
+double linkCapacity(int baud) {
+    return baud > 0 ? (double) baud / SERIAL_BITS_PER_BYTE : 0;
+}
+
+double maximumFrameRate(int baud, std::size_t frameBytes) {
+    if (baud <= 0 || frameBytes == 0) {
+        return 0;
+    }
+    return linkCapacity(baud) / (double) frameBytes;
+}
+
+LinkBudget::LinkBudget(int baud) : baud(baud) {}
+
+void LinkBudget::setBaud(int newBaud) {
+    std::lock_guard<std::mutex> lock(mutex);
+    baud = newBaud;
+}
+
+int LinkBudget::getBaud() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return baud;
+}
+
+long long LinkBudget::intervalOf(MonotonicClock::time_point time) {
+    return time.time_since_epoch() / LINK_BUDGET_BUCKET_LENGTH;
+}
+
+void LinkBudget::record(std::size_t bytes, MonotonicClock::time_point now) {
+    long long interval = intervalOf(now);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (totalFrames == 0) {
+        firstRecord = now;
+    }
+    Bucket &bucket = buckets[interval % LINK_BUDGET_BUCKETS];
+    if (bucket.interval != interval) {
+        bucket = Bucket{interval, 0, 0};
+    }
+    bucket.bytes += (long) bytes;
+    bucket.frames++;
+    totalBytes += (long) bytes;
+    totalFrames++;
+}
+
+LinkBudgetStatistics LinkBudget::getStatistics(MonotonicClock::time_point now) const {
+    long long interval = intervalOf(now);
+    std::lock_guard<std::mutex> lock(mutex);
+    LinkBudgetStatistics statistics;
+    statistics.baud = baud;
+    statistics.capacity = linkCapacity(baud);
+    statistics.totalBytes = totalBytes;
+    statistics.totalFrames = totalFrames;
+    if (totalFrames == 0) {
+        return statistics;
+    }
+
+    long bytes = 0;
+    long frames = 0;
+    for (const Bucket &bucket: buckets) {
+        if (bucket.interval > interval - LINK_BUDGET_BUCKETS && bucket.interval <= interval) {
+            bytes += bucket.bytes;
+            frames += bucket.frames;
+        }
+    }
+    // A young link is measured over its lifetime, rounded up to whole buckets like the window itself
+    auto window = std::chrono::duration<double>(LINK_BUDGET_BUCKET_LENGTH * LINK_BUDGET_BUCKETS);
+    auto age = std::chrono::duration<double>(LINK_BUDGET_BUCKET_LENGTH * (interval - intervalOf(firstRecord) + 1));
+    double seconds = std::min(window, age).count();
+    statistics.bytesPerSecond = (double) bytes / seconds;
+    statistics.framesPerSecond = (double) frames / seconds;
+    statistics.meanFrameBytes = frames > 0 ? (double) bytes / (double) frames : 0;
+    statistics.utilization = statistics.capacity > 0 ? statistics.bytesPerSecond / statistics.capacity : 0;
+    return statistics;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Timing.h"
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+/// @brief Bits on the wire for each byte of serial data (a start bit, 8 data bits and a stop bit)
+const int SERIAL_BITS_PER_BYTE = 10;
+
+/// @brief Number of buckets the measurement window is split into
+const int LINK_BUDGET_BUCKETS = 10;
+
+/// @brief Length of one bucket of the measurement window (the window is one second long)
+const std::chrono::milliseconds LINK_BUDGET_BUCKET_LENGTH{100};
+
+/// @brief How much of a serial link's capacity is being used, measured over the last second
+struct LinkBudgetStatistics {
+    /// @brief The baud rate of the link, or 0 if it is not known (e.g. no serial port is open)
+    int baud = 0;
+    /// @brief The most bytes per second the link can carry
+    double capacity = 0;
+    double bytesPerSecond = 0;
+    double framesPerSecond = 0;
+    /// @brief Average size of a frame (a single serial write)
+    double meanFrameBytes = 0;
+    /// @brief bytesPerSecond as a fraction of capacity, or 0 if the baud rate is not known
+    double utilization = 0;
+    long totalBytes = 0;
+    long totalFrames = 0;
+};
+
+/// @brief The most bytes per second a serial link can carry
+/// @param baud the baud rate of the link
+double linkCapacity(int baud);
+
+/// @brief The most frames per second a serial link can carry
+/// @param baud the baud rate of the link
+/// @param frameBytes the size of each frame
+/// @return The rate, or 0 if either argument is not positive
+double maximumFrameRate(int baud, std::size_t frameBytes);
+
+/// @brief Counts the bytes and frames written to a serial link in a one-second sliding window, so that saturation of the
+/// link shows up as a utilization near 1 instead of as growing latency. Safe to use from several threads.
+class LinkBudget {
+private:
+    struct Bucket {
+        /// @brief Which bucket-length interval since the clock's epoch this bucket holds
+        long long interval = -1;
+        long bytes = 0;
+        long frames = 0;
+    };
+
+    mutable std::mutex mutex;
+    int baud;
+    Bucket buckets[LINK_BUDGET_BUCKETS];
+    MonotonicClock::time_point firstRecord;
+    long totalBytes = 0;
+    long totalFrames = 0;
+
+    static long long intervalOf(MonotonicClock::time_point time);
+
+public:
+    /// @param baud the baud rate of the link, or 0 if it is not known
+    explicit LinkBudget(int baud = 0);
+
+    /// @brief Change the baud rate used to compute utilization
+    void setBaud(int newBaud);
+
+    int getBaud() const;
+
+    /// @brief Count a frame written to the link
+    /// @param bytes the size of the frame
+    /// @param now when it was written
+    void record(std::size_t bytes, MonotonicClock::time_point now = MonotonicClock::now());
+
+    /// @brief The rates over the last second (or since the first frame, if that was less than a second ago)
+    /// @param now the end of the window
+    LinkBudgetStatistics getStatistics(MonotonicClock::time_point now = MonotonicClock::now()) const;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/// @brief A bounded, lock-free queue for exactly one producer thread and one consumer thread. All storage is allocated
+/// up front, so pushing and popping never allocate.
+/// @tparam T the element type. Elements are copied in and out, so it should be cheap to copy.
+template<typename T>
+class RingBuffer {
+private:
+    std::vector<T> slots;
+    std::size_t mask;
+    alignas(64) std::atomic<std::size_t> head{0}; // next slot to read, only written by the consumer
+    alignas(64) std::atomic<std::size_t> tail{0}; // next slot to write, only written by the producer
+
+    static std::size_t roundUpToPowerOfTwo(std::size_t value) {
+        std::size_t power = 1;
+        while (power < value) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+public:
+    /// @param capacity the minimum number of elements the buffer can hold. Rounded up to a power of two.
+    explicit RingBuffer(std::size_t capacity) : slots(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity)),
+                                                mask(slots.size() - 1) {}
+
+    RingBuffer(const RingBuffer &) = delete;
+
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    /// @brief Producer only: get a slot that a later publish() will make visible, so it can be filled in place
+    /// @param offset which unpublished slot to get: 0 for the one the next push() would use, 1 for the one after, ...
+    /// @return The slot, or nullptr if the buffer does not have room for it
+    T *reserve(std::size_t offset = 0) {
+        std::size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail + offset - head.load(std::memory_order_acquire) >= slots.size()) {
+            return nullptr;
+        }
+        return &slots[(currentTail + offset) & mask];
+    }
+
+    /// @brief Producer only: make slots returned by reserve() visible to the consumer, all at once
+    /// @param count the number of slots, starting from offset 0
+    void publish(std::size_t count = 1) {
+        tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    /// @brief Producer only: add an element
+    /// @return False if the buffer is full (the element is not added)
+    bool push(const T &element) {
+        T *slot = reserve();
+        if (slot == nullptr) {
+            return false;
+        }
+        *slot = element;
+        publish();
+        return true;
+    }
+
+    /// @brief Consumer only: get the oldest element without removing it
+    /// @return The element, or nullptr if the buffer is empty
+    T *front() {
+        std::size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[currentHead & mask];
+    }
+
+    /// @brief Consumer only: remove the element returned by front()
+    void release() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// @brief Consumer only: remove the oldest element
+    /// @return False if the buffer is empty
+    bool pop(T &element) {
+        T *slot = front();
+        if (slot == nullptr) {
+            return false;
+        }
+        element = *slot;
+        release();
+        return true;
+    }
+
+    /// @brief Number of elements currently queued. Exact only when called from the producer or consumer thread.
+    std::size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    std::size_t capacity() const {
+        return slots.size();
+    }
+};
@@ -0,0 +1,139 @@
+#include "Sequence_Compiler.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+bool compileSequence(const Sequence &sequence, const std::array<int, THRUSTER_COUNT> &thrusterPins, WireProtocol protocol,
+                     std::ostream &output) {
+    for (int pin: thrusterPins) {
+        if (pin < 0 || pin >= PICO_GPIO_COUNT) {
+            return false;
+        }
+    }
+
+    // Encode with a WiringControl that has no serial port, set up the way Command_Interpreter_RPi5 sets up its own,
+    // so the frames match what it would send. Binary sequence numbers are stamped again when the frames are sent.
+    std::ostringstream encoded;
+    std::ostringstream discard;
+    WiringControl encoder(encoded, discard, discard);
+    encoder.setWireProtocol(protocol);
+    encoder.beginFrame();
+    for (int pin: thrusterPins) {
+        encoder.setPinType(pin, HardwarePWM);
+    }
+    encoder.endFrame();
+
+    CompiledSequenceHeader header{};
+    header.protocol = protocol;
+    header.thrusterCount = THRUSTER_COUNT;
+    for (std::size_t i = 0; i < thrusterPins.size(); i++) {
+        header.thrusterPins[i] = thrusterPins[i];
+    }
+
+    std::vector<CompiledPhase> phases;
+    std::string frames;
+    std::chrono::nanoseconds offset(0);
+    for (std::size_t i = 0; i < sequence.commands.size(); i++) {
+        const Command &command = sequence.commands[i];
+        const CommandComponent *components[3] = {&command.acceleration, &command.steadyState, &command.deceleration};
+        for (int phase = 0; phase < 3; phase++) {
+            if (components[phase]->duration.count() <= 0) {
+                continue;
+            }
+            encoded.str("");
+            encoder.pwmWriteFrame(thrusterPins.data(), components[phase]->thruster_pwms.pwm_signals,
+                                  THRUSTER_COUNT);
+            std::string frame = encoded.str();
+
+            CompiledPhase compiled{};
+            compiled.start = offset.count();
+            compiled.frameOffset = (uint32_t) frames.size();
+            compiled.frameLength = (uint32_t) frame.size();
+            compiled.commandIndex = (uint32_t) i;
+            compiled.phase = (uint32_t) phase;
+            for (int pin = 0; pin < THRUSTER_COUNT; pin++) {
+                compiled.pulseWidths[pin] = (int16_t) components[phase]->thruster_pwms.pwm_signals[pin];
+            }
+            phases.push_back(compiled);
+            frames.append(frame);
+            offset += components[phase]->duration;
+        }
+    }
+    header.phaseCount = (uint32_t) phases.size();
+    header.duration = offset.count();
+
+    std::size_t framesStart = sizeof(COMPILED_SEQUENCE_MAGIC) + sizeof(header) + phases.size() * sizeof(CompiledPhase);
+    for (CompiledPhase &phase: phases) {
+        phase.frameOffset += (uint32_t) framesStart;
+    }
+    output.write(COMPILED_SEQUENCE_MAGIC, sizeof(COMPILED_SEQUENCE_MAGIC));
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char *>(phases.data()), (std::streamsize) (phases.size() * sizeof(CompiledPhase)));
+    output.write(frames.data(), (std::streamsize) frames.size());
+    output.flush();
+    return (bool) output;
+}
+
+CompiledSequence::CompiledSequence(const std::string &path, std::ostream &errorLog) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        errorLog << "Unable to open compiled sequence " << path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    struct stat status{};
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+        errorLog << "Compiled sequence " << path << " is empty!" << std::endl;
+        close(fd);
+        return;
+    }
+    void *mapping = mmap(nullptr, (std::size_t) status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        errorLog << "Unable to map compiled sequence " << path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    data = static_cast<const char *>(mapping);
+    size = (std::size_t) status.st_size;
+    // Start reading the whole file in now, so the timed replay does not wait for the disk
+    madvise(mapping, size, MADV_WILLNEED);
+    if (!validate()) {
+        errorLog << "Compiled sequence " << path << " is invalid!" << std::endl;
+        sequenceHeader = nullptr;
+        phases = nullptr;
+    }
+}
+
+bool CompiledSequence::validate() {
+    std::size_t phasesStart = sizeof(COMPILED_SEQUENCE_MAGIC) + sizeof(CompiledSequenceHeader);
+    if (size < phasesStart || std::memcmp(data, COMPILED_SEQUENCE_MAGIC, sizeof(COMPILED_SEQUENCE_MAGIC)) != 0) {
+        return false;
+    }
+    sequenceHeader = reinterpret_cast<const CompiledSequenceHeader *>(data + sizeof(COMPILED_SEQUENCE_MAGIC));
+    if ((sequenceHeader->protocol != AsciiProtocol && sequenceHeader->protocol != BinaryProtocol) ||
+        sequenceHeader->thrusterCount != THRUSTER_COUNT) {
+        return false;
+    }
+    if ((size - phasesStart) / sizeof(CompiledPhase) < sequenceHeader->phaseCount) {
+        return false;
+    }
+    phases = reinterpret_cast<const CompiledPhase *>(data + phasesStart);
+    for (std::size_t i = 0; i < sequenceHeader->phaseCount; i++) {
+        if (phases[i].frameOffset > size || phases[i].frameLength > size - phases[i].frameOffset ||
+            phases[i].frameLength > PENDING_FRAME_CAPACITY) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CompiledSequence::~CompiledSequence() {
+    if (data != nullptr) {
+        munmap(const_cast<char *>(data), size);
+    }
+}
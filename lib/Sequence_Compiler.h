@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Command.h"
+#include "Wiring.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/*
+ * Compiled sequence format (native byte order, little endian on the Pi):
+ *
+ *     "PROPSEQ1" | CompiledSequenceHeader | CompiledPhase x phaseCount | frame bytes
+ *
+ * Every phase of the sequence (phases with no duration are left out) becomes one pre-encoded wire frame that sets all
+ * thrusters, exactly as Command_Interpreter_RPi5::execute() would have sent it. Binary frames carry the sequence
+ * numbers they were compiled with. Phase start times are relative to the start of the sequence. The header and phase
+ * sizes depend on THRUSTER_COUNT, which is recorded in the header: a file can only be replayed by a build with the same
+ * thruster count.
+ */
+
+/// @brief Magic bytes at the start of every compiled sequence
+const char COMPILED_SEQUENCE_MAGIC[8] = {'P', 'R', 'O', 'P', 'S', 'E', 'Q', '1'};
+
+/// @brief What a compiled sequence was compiled for
+struct CompiledSequenceHeader {
+    /// @brief The WireProtocol the frames are encoded in
+    uint32_t protocol;
+    uint32_t phaseCount;
+    /// @brief THRUSTER_COUNT of the build that compiled the sequence
+    uint32_t thrusterCount;
+    uint32_t reserved;
+    /// @brief Length of the whole sequence, in nanoseconds
+    int64_t duration;
+    /// @brief GPIO numbers of the thrusters, in the order the interpreter drives them
+    int32_t thrusterPins[THRUSTER_COUNT];
+};
+
+/// @brief One phase of a compiled sequence
+struct CompiledPhase {
+    /// @brief When the phase starts, in nanoseconds from the start of the sequence
+    int64_t start;
+    /// @brief Where the phase's frame starts, in bytes from the start of the file
+    uint32_t frameOffset;
+    uint32_t frameLength;
+    uint32_t commandIndex;
+    /// @brief The CommandPhase
+    uint32_t phase;
+    int16_t pulseWidths[THRUSTER_COUNT];
+};
+
+/// @brief Encode every phase of a sequence into wire frames ahead of time
+/// @param sequence the sequence to compile
+/// @param thrusterPins the GPIO numbers of the thrusters, in the same order as the interpreter's thruster pins
+/// @param protocol the protocol to encode the frames in
+/// @param output where to write the compiled sequence (opened in binary mode)
+/// @return False if the output could not be written, or a thruster is not on link 0 (compiled frames only address a
+/// single Pico)
+bool compileSequence(const Sequence &sequence, const std::array<int, THRUSTER_COUNT> &thrusterPins, WireProtocol protocol,
+                     std::ostream &output);
+
+/// @brief A compiled sequence file, mapped into memory. Nothing is parsed or copied: phases and frames are read
+/// straight from the mapping.
+class CompiledSequence {
+private:
+    const char *data = nullptr;
+    std::size_t size = 0;
+    const CompiledSequenceHeader *sequenceHeader = nullptr;
+    const CompiledPhase *phases = nullptr;
+
+    /// @brief Check that the file is a compiled sequence and every frame lies inside it
+    bool validate();
+
+public:
+    /// @param path the compiled sequence file
+    /// @param errorLog where you want error messages to be logged
+    CompiledSequence(const std::string &path, std::ostream &errorLog);
+
+    CompiledSequence(const CompiledSequence &) = delete;
+
+    CompiledSequence &operator=(const CompiledSequence &) = delete;
+
+    /// @brief Whether the file was mapped and is a valid compiled sequence
+    bool isOpen() const { return sequenceHeader != nullptr; }
+
+    const CompiledSequenceHeader &header() const { return *sequenceHeader; }
+
+    std::size_t phaseCount() const { return sequenceHeader->phaseCount; }
+
+    const CompiledPhase &phase(std::size_t index) const { return phases[index]; }
+
+    /// @brief The pre-encoded frame of a phase
+    const char *frame(std::size_t index) const { return data + phases[index].frameOffset; }
+
+    std::chrono::nanoseconds duration() const { return std::chrono::nanoseconds(sequenceHeader->duration); }
+
+    ~CompiledSequence();
+};
@@ -1,6 +1,7 @@
 #ifndef MOCK_RPI
 
 #include "Serial.h"
+#include "Serial_Writer.h"
 
 
 int serialOpen(const char *device, const int baud) { //from WiringPi
@@ -45,14 +46,18 @@ int serialOpen(const char *device, const int baud) { //from WiringPi
       return -2 ;
   }
 
-  if ((fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY | O_NONBLOCK)) == -1)
+  // O_NONBLOCK keeps open() from waiting for the modem lines; writes block normally once the port is set up
+  if ((fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY | O_NONBLOCK | O_CLOEXEC)) == -1)
     return -1 ;
 
   fcntl (fd, F_SETFL, O_RDWR) ;
 
 // Get and modify current options:
 
-  tcgetattr (fd, &options) ;
+  if (tcgetattr (fd, &options) != 0) {
+    close (fd) ;
+    return -1 ;
+  }
 
     cfmakeraw   (&options) ;
     cfsetispeed (&options, myBaud) ;
@@ -78,18 +83,33 @@ int serialOpen(const char *device, const int baud) { //from WiringPi
 
   ioctl (fd, TIOCMSET, &status);
 
-  usleep (10000) ;	// 10mS
-
   return fd ;
 }
 
 
-void serialPuts(const int fd, const char *s) { // from WiringPi
-    size_t len = strlen(s);
-    ssize_t bytes_written = write(fd, s, len);
-    if (bytes_written != (ssize_t)len) {
+bool serialWrite(const int fd, const char *data, size_t length) {
+    if (!writeFully(fd, data, length)) {
         perror("Error writing to file descriptor");
+        return false;
+    }
+    return true;
+}
+
+/// @brief Claim an open serial device for this process, so a second driver cannot interleave its own frames with ours
+/// @return False if another process already holds the device (the descriptor is left open)
+bool serialLock(const int fd) {
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        return false;
     }
+    // Also refuse plain open() calls from programs that do not take the lock
+    ioctl(fd, TIOCEXCL);
+    return true;
+}
+
+/// @brief Give up the claim taken by serialLock(), before closing the device
+void serialUnlock(const int fd) {
+    ioctl(fd, TIOCNXCL);
+    flock(fd, LOCK_UN);
 }
 
 int serialGetchar (const int fd) { // from WiringPi
@@ -102,7 +122,8 @@ int serialGetchar (const int fd) { // from WiringPi
 }
 
 void echoOn(int serial) {
-    serialPuts(serial, "echo on\n");
+    const char message[] = "echo on\n";
+    serialWrite(serial, message, sizeof(message) - 1);
 }
 
 
@@ -5,13 +5,16 @@
 #include <string.h>
 #include <termios.h>
 #include <unistd.h>
+#include <sys/file.h>
 #include <sys/ioctl.h>
 #include <iostream>
 #include <cstdint>
 #include <string>
 
 int serialOpen(const char *device, const int baud);
-void serialPuts(const int fd, const char *s);
+bool serialWrite(const int fd, const char *data, size_t length);
+bool serialLock(const int fd);
+void serialUnlock(const int fd);
 int serialGetchar (const int fd);
 void echoOn(int serial);
 bool initializeSerial(int *serial);
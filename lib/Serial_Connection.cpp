@@ -0,0 +1,171 @@
+#include "Serial_Connection.h"
+
+#include <algorithm>
+#include <glob.h>
+#include <utility>
+
+std::vector<std::string> discoverSerialDevices(const std::vector<std::string> &patterns) {
+    std::vector<std::string> devices;
+    for (const std::string &pattern: patterns) {
+        glob_t matches{};
+        if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+            for (std::size_t i = 0; i < matches.gl_pathc; i++) {
+                std::string device = matches.gl_pathv[i];
+                if (std::find(devices.begin(), devices.end(), device) == devices.end()) {
+                    devices.push_back(device);
+                }
+            }
+        }
+        globfree(&matches);
+    }
+    return devices;
+}
+
+void SerialConnection::markLost() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!connected.exchange(false)) {
+        return;
+    }
+    statistics.disconnects++;
+    lostAt = MonotonicClock::now();
+    errorLog << "Lost serial connection to " << statistics.device << "!" << std::endl;
+    wakeCondition.notify_all();
+}
+
+void SerialConnection::countDroppedWrite() {
+    std::lock_guard<std::mutex> lock(mutex);
+    statistics.droppedWrites++;
+}
+
+bool SerialConnection::takeRestoreRequest() {
+    return restorePending.load(std::memory_order_acquire) && restorePending.exchange(false);
+}
+
+void SerialConnection::setReconnectHandler(std::function<void()> handler) {
+    std::lock_guard<std::mutex> lock(mutex);
+    reconnectHandler = std::move(handler);
+}
+
+bool SerialConnection::waitForConnection(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return connectedCondition.wait_for(lock, timeout, [this]() { return connected.load(); });
+}
+
+SerialConnectionStatistics SerialConnection::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+#ifndef MOCK_RPI
+
+#include "Serial.h"
+
+#include <poll.h>
+
+SerialConnection::SerialConnection(SerialConfig config, std::ostream &errorLog)
+        : config(std::move(config)), errorLog(errorLog) {}
+
+int SerialConnection::openFirstDevice(std::string &device) {
+    for (const std::string &candidate: discoverSerialDevices(config.devices)) {
+        int opened = serialOpen(candidate.c_str(), config.baud);
+        if (opened == -2) {
+            errorLog << "Unsupported baud rate " << config.baud << "!" << std::endl;
+            return -1;
+        }
+        if (opened < 0) {
+            continue;
+        }
+        // Another driver already owns this device: writing to it as well would corrupt both streams
+        if (!serialLock(opened)) {
+            close(opened);
+            continue;
+        }
+        device = candidate;
+        return opened;
+    }
+    return -1;
+}
+
+bool SerialConnection::open() {
+    if (fd != -1) {
+        return isConnected();
+    }
+    std::string device;
+    int opened = openFirstDevice(device);
+    if (opened < 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    fd = opened;
+    statistics.device = device;
+    connected.store(true, std::memory_order_release);
+    if (config.reconnect) {
+        running = true;
+        monitorThread = std::thread(&SerialConnection::monitor, this);
+    }
+    return true;
+}
+
+void SerialConnection::monitor() {
+    std::chrono::milliseconds backoff = config.minimumBackoff;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        if (connected.load()) {
+            lock.unlock();
+            // Waits for nothing but hang-ups and errors, which poll() always reports
+            struct pollfd request{fd, 0, 0};
+            int ready = ::poll(&request, 1, 100);
+            lock.lock();
+            if (ready > 0 && (request.revents & (POLLHUP | POLLERR | POLLNVAL)) && connected.load()) {
+                lock.unlock();
+                markLost();
+                lock.lock();
+            }
+            backoff = config.minimumBackoff;
+            continue;
+        }
+
+        lock.unlock();
+        std::string device;
+        int opened = openFirstDevice(device);
+        lock.lock();
+        if (opened < 0) {
+            statistics.failedAttempts++;
+            wakeCondition.wait_for(lock, backoff, [this]() { return !running; });
+            backoff = std::min(backoff * 2, config.maximumBackoff);
+            continue;
+        }
+        // Move the new device onto the old descriptor number, so nobody holding the number has to be told
+        dup2(opened, fd);
+        close(opened);
+        statistics.reconnects++;
+        statistics.lastOutage = std::chrono::duration_cast<std::chrono::nanoseconds>(MonotonicClock::now() - lostAt);
+        statistics.device = device;
+        restorePending.store(true, std::memory_order_release);
+        connected.store(true, std::memory_order_release);
+        connectedCondition.notify_all();
+        std::function<void()> handler = reconnectHandler;
+        lock.unlock();
+        if (handler) {
+            handler();
+        }
+        lock.lock();
+    }
+}
+
+SerialConnection::~SerialConnection() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        wakeCondition.notify_all();
+    }
+    if (monitorThread.joinable()) {
+        monitorThread.join();
+    }
+    if (fd != -1) {
+        serialUnlock(fd);
+        close(fd);
+    }
+}
+
+#endif
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Timing.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @brief Where to find the Pico and how to talk to it
+struct SerialConfig {
+    /// @brief Device paths or glob patterns, tried in order. The first device that opens and is not already held by
+    /// another process is used, so broad patterns (e.g. "/dev/ttyACM*") only ever pick a free device.
+    std::vector<std::string> devices{"/dev/serial/by-id/usb-MicroPython_Board_in_FS_mode_e66130100f198434-if00"};
+    int baud = 115200;
+    /// @brief Whether to reopen the device in the background when the connection is lost
+    bool reconnect = true;
+    /// @brief Wait after the first failed reconnect attempt. Doubles with each further failure.
+    std::chrono::milliseconds minimumBackoff{5};
+    /// @brief Longest wait between reconnect attempts
+    std::chrono::milliseconds maximumBackoff{500};
+};
+
+/// @brief Counters describing the health of a serial connection
+struct SerialConnectionStatistics {
+    long disconnects = 0;
+    long reconnects = 0;
+    /// @brief Reconnect attempts that found no device that could be opened
+    long failedAttempts = 0;
+    /// @brief Writes thrown away because the connection was down
+    long droppedWrites = 0;
+    /// @brief Time from losing the connection until it was reopened, for the most recent outage
+    std::chrono::nanoseconds lastOutage{0};
+    /// @brief The device currently (or last) open
+    std::string device;
+};
+
+/// @brief Expand the device paths and glob patterns of a serial config into the devices that currently exist
+/// @param patterns device paths or glob patterns
+/// @return Every existing device, in the order of the patterns (sorted within a pattern), without duplicates
+std::vector<std::string> discoverSerialDevices(const std::vector<std::string> &patterns);
+
+/// @brief An open serial device that reopens itself when it disappears (e.g. the Pico's USB cable is unplugged). A
+/// background thread watches for the device hanging up and, while it is gone, retries discovery with exponential
+/// backoff. The file descriptor number never changes: a reopened device is moved onto the old number, so readers and
+/// writers holding the number keep working. The open device is locked (flock and TIOCEXCL) until the connection is
+/// destroyed. Devices can only be opened when not compiled with MOCK_RPI.
+class SerialConnection {
+private:
+    SerialConfig config;
+    std::ostream &errorLog;
+    int fd = -1;
+    std::atomic<bool> connected{false};
+    std::atomic<bool> restorePending{false};
+    std::thread monitorThread;
+    mutable std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable connectedCondition;
+    bool running = false;
+    MonotonicClock::time_point lostAt;
+    std::function<void()> reconnectHandler;
+    SerialConnectionStatistics statistics;
+
+    /// @brief Try every discovered device once
+    /// @return The opened file descriptor, or -1 if none could be opened
+    int openFirstDevice(std::string &device);
+
+    void monitor();
+
+public:
+    /// @param config where to find the device and how to reconnect
+    /// @param errorLog where you want error messages to be logged
+    SerialConnection(SerialConfig config, std::ostream &errorLog);
+
+    SerialConnection(const SerialConnection &) = delete;
+
+    SerialConnection &operator=(const SerialConnection &) = delete;
+
+    /// @brief Open the first device that can be opened and, if enabled, start watching it
+    /// @return False if no device could be opened
+    bool open();
+
+    /// @brief The file descriptor of the device, or -1 before open() succeeds
+    int getFd() const { return fd; }
+
+    bool isConnected() const { return connected.load(std::memory_order_acquire); }
+
+    /// @brief Report that the device failed (e.g. a write error). The monitor thread starts reconnecting.
+    void markLost();
+
+    /// @brief Count a write that was thrown away because the connection was down
+    void countDroppedWrite();
+
+    /// @brief Whether the device has been reopened since the last call. Clears the flag. The Pico may have restarted,
+    /// so everything it knew has to be sent again.
+    bool takeRestoreRequest();
+
+    /// @brief Set a function called on the monitor thread each time the device is reopened
+    void setReconnectHandler(std::function<void()> handler);
+
+    /// @brief Wait until the device is open
+    /// @param timeout the longest time to wait
+    /// @return True if the device is open
+    bool waitForConnection(std::chrono::milliseconds timeout);
+
+    SerialConnectionStatistics getStatistics() const;
+
+    ~SerialConnection();
+};
@@ -0,0 +1,168 @@
+#include "Serial_Reader.h"
+#include "Wire_Protocol.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <utility>
+
+SerialReader::SerialReader(int fd, std::ostream &errorLog, std::size_t bufferSize)
+        : fd(fd), errorLog(errorLog),
+          buffer(std::max(bufferSize, binaryFrameSize(BINARY_FRAME_MAX_RECORDS))) {}
+
+void SerialReader::setLineHandler(LineHandler handler) {
+    lineHandler = std::move(handler);
+}
+
+void SerialReader::setFrameHandler(FrameHandler handler) {
+    frameHandler = std::move(handler);
+}
+
+void SerialReader::setTrafficCapture(std::shared_ptr<TrafficCapture> trafficCapture) {
+    capture = std::move(trafficCapture);
+}
+
+int SerialReader::dispatch() {
+    int messages = 0;
+    while (readPosition < writePosition) {
+        const char *message = buffer.data() + readPosition;
+        std::size_t available = writePosition - readPosition;
+
+        if ((uint8_t) message[0] == BINARY_FRAME_SYNC) {
+            if (available < BINARY_FRAME_HEADER_SIZE) {
+                break;
+            }
+            std::size_t frameSize = binaryFrameSize((uint8_t) message[3]);
+            if (available < frameSize) {
+                break;
+            }
+            const auto *frame = reinterpret_cast<const uint8_t *>(message);
+            if (crc8(frame + 1, frameSize - 2) != frame[frameSize - 1]) {
+                // A corrupted frame: drop bytes until the next sync byte or the end of the next line
+                statistics.checksumErrors++;
+                std::size_t skip = 1;
+                while (skip < available && (uint8_t) message[skip] != BINARY_FRAME_SYNC && message[skip] != '\n') {
+                    skip++;
+                }
+                if (skip < available && message[skip] == '\n') {
+                    skip++;
+                }
+                readPosition += skip;
+                continue;
+            }
+            statistics.frames++;
+            if (frameHandler) {
+                frameHandler(frame, frameSize);
+            }
+            readPosition += frameSize;
+            messages++;
+            continue;
+        }
+
+        const char *newline = static_cast<const char *>(std::memchr(message, '\n', available));
+        std::size_t lineLength;
+        if (newline != nullptr) {
+            lineLength = newline - message;
+        } else if (readPosition == 0 && writePosition == buffer.size()) {
+            // The line fills the whole buffer: hand over what there is rather than stalling forever
+            statistics.overlongLines++;
+            lineLength = available;
+        } else {
+            break;
+        }
+        statistics.lines++;
+        if (lineHandler) {
+            lineHandler(message, lineLength);
+        }
+        readPosition += std::min(lineLength + 1, available);
+        messages++;
+    }
+    if (readPosition == writePosition) {
+        readPosition = writePosition = 0;
+    }
+    return messages;
+}
+
+bool SerialReader::readAvailable() {
+    if (readPosition > 0) {
+        std::memmove(buffer.data(), buffer.data() + readPosition, writePosition - readPosition);
+        writePosition -= readPosition;
+        readPosition = 0;
+    }
+    while (true) {
+        // One read() takes everything the kernel has buffered, up to the free space
+        ssize_t result = read(fd, buffer.data() + writePosition, buffer.size() - writePosition);
+        if (result > 0) {
+            if (capture) {
+                capture->record(IncomingTraffic, buffer.data() + writePosition, (std::size_t) result);
+            }
+            statistics.reads++;
+            statistics.bytesRead += result;
+            writePosition += result;
+            return true;
+        }
+        if (result == 0) {
+            return false;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return true;
+        }
+        errorLog << "Error reading serial: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+}
+
+int SerialReader::poll(std::chrono::milliseconds timeout) {
+    struct pollfd request{fd, POLLIN, 0};
+    int ready = ::poll(&request, 1, (int) timeout.count());
+    if (ready < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    if (ready == 0) {
+        return 0;
+    }
+    if (!(request.revents & POLLIN)) {
+        // Hung up or errored with nothing left to read
+        return -1;
+    }
+    bool open = readAvailable();
+    int messages = dispatch();
+    if (!open && messages == 0) {
+        return -1;
+    }
+    return messages;
+}
+
+void SerialReader::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    // The previous thread may have ended on its own when the file descriptor hung up
+    if (readerThread.joinable()) {
+        readerThread.join();
+    }
+    readerThread = std::thread([this]() {
+        while (running.load()) {
+            if (poll(std::chrono::milliseconds(50)) < 0) {
+                running.store(false);
+                break;
+            }
+        }
+    });
+}
+
+void SerialReader::stop() {
+    running.store(false);
+    if (readerThread.joinable()) {
+        readerThread.join();
+    }
+}
+
+SerialReader::~SerialReader() {
+    stop();
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Traffic_Capture.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+/// @brief Counters describing what the serial reader has received
+struct SerialReaderStatistics {
+    /// @brief Number of read() calls that returned data
+    long reads = 0;
+    long bytesRead = 0;
+    long lines = 0;
+    long frames = 0;
+    /// @brief Binary frames dropped because their checksum was wrong
+    long checksumErrors = 0;
+    /// @brief Lines longer than the buffer, delivered in pieces
+    long overlongLines = 0;
+};
+
+/// @brief Reads messages from the Pico in large chunks and splits them into text lines and binary frames (see
+/// Wire_Protocol.h). A message starting with the binary sync byte is a frame; anything else is a line ending in '\n'.
+/// Messages are handed to callbacks, which run on whichever thread is reading (the caller of poll(), or the reader
+/// thread started by start()).
+class SerialReader {
+public:
+    /// @brief Called with each line, without its trailing newline. The data is only valid during the call.
+    using LineHandler = std::function<void(const char *line, std::size_t length)>;
+    /// @brief Called with each complete binary frame (checksum already verified). The data is only valid during the call.
+    using FrameHandler = std::function<void(const uint8_t *frame, std::size_t length)>;
+
+private:
+    int fd;
+    std::ostream &errorLog;
+    std::vector<char> buffer;
+    std::size_t readPosition = 0; // first byte not yet handed to a callback
+    std::size_t writePosition = 0; // one past the last byte read
+    LineHandler lineHandler;
+    FrameHandler frameHandler;
+    std::thread readerThread;
+    std::atomic<bool> running{false};
+    SerialReaderStatistics statistics;
+    std::shared_ptr<TrafficCapture> capture;
+
+    /// @brief Hand every complete message in the buffer to the callbacks
+    /// @return The number of messages dispatched
+    int dispatch();
+
+    /// @brief Read whatever is available (up to the free space in the buffer) with a single read()
+    /// @return False on end of file or a read error
+    bool readAvailable();
+
+public:
+    /// @param fd the file descriptor to read. It is not closed by the reader.
+    /// @param errorLog where you want error messages to be logged
+    /// @param bufferSize the largest message that can be received in one piece
+    SerialReader(int fd, std::ostream &errorLog, std::size_t bufferSize = 4096);
+
+    SerialReader(const SerialReader &) = delete;
+
+    SerialReader &operator=(const SerialReader &) = delete;
+
+    /// @brief Set the function called with each text line. Must not be changed while the reader thread is running.
+    void setLineHandler(LineHandler handler);
+
+    /// @brief Set the function called with each binary frame. Must not be changed while the reader thread is running.
+    void setFrameHandler(FrameHandler handler);
+
+    /// @brief Record everything read in a traffic capture. Must not be changed while the reader thread is running.
+    /// @param trafficCapture the capture to record into, or nullptr to stop recording
+    void setTrafficCapture(std::shared_ptr<TrafficCapture> trafficCapture);
+
+    /// @brief Wait for data, read everything available and dispatch the complete messages
+    /// @param timeout the longest time to wait for data
+    /// @return The number of messages dispatched, or -1 if the file descriptor was closed or could not be read
+    int poll(std::chrono::milliseconds timeout);
+
+    /// @brief Start a thread that calls poll() until stop() is called or the file descriptor is closed. May be called
+    /// again to restart the thread after the file descriptor was closed and reopened.
+    void start();
+
+    /// @brief Stop the reader thread (within one poll interval)
+    void stop();
+
+    /// @brief What has been received so far. Only exact when the reader thread is not running.
+    SerialReaderStatistics getStatistics() const { return statistics; }
+
+    ~SerialReader();
+};
@@ -0,0 +1,138 @@
+#include "Serial_Writer.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <utility>
+
+bool writeFully(int fd, const char *data, std::size_t length, std::chrono::milliseconds timeout) {
+    std::size_t written = 0;
+    while (written < length) {
+        ssize_t result = write(fd, data + written, length - written);
+        if (result >= 0) {
+            written += result;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return false;
+        }
+        struct pollfd request{fd, POLLOUT, 0};
+        int ready = poll(&request, 1, (int) timeout.count());
+        if (ready == 0) {
+            errno = ETIMEDOUT;
+            return false;
+        }
+        if (ready < 0 && errno != EINTR) {
+            return false;
+        }
+        // Writable, or hung up: either way the next write() says which
+    }
+    return true;
+}
+
+SerialWriter::SerialWriter(int fd, std::size_t capacity, std::ostream &errorLog, std::function<void()> errorHandler)
+        : fd(fd), errorLog(errorLog), errorHandler(std::move(errorHandler)), queue(capacity) {
+    writerThread = std::thread(&SerialWriter::run, this);
+}
+
+bool SerialWriter::enqueue(const char *data, std::size_t length) {
+    std::size_t slotsNeeded = (length + SERIAL_WRITER_SLOT_SIZE - 1) / SERIAL_WRITER_SLOT_SIZE;
+    if (queue.capacity() - queue.size() < slotsNeeded) {
+        overflows++;
+        // Log the start of each run of dropped frames rather than every one of them
+        if (!overflowing) {
+            errorLog << "Serial writer queue full, dropping frame of " << length << " bytes (" << overflows
+                     << " dropped so far)!" << std::endl;
+            overflowing = true;
+        }
+        return false;
+    }
+    overflowing = false;
+    while (length > 0) {
+        Slot *slot = queue.reserve();
+        slot->length = std::min(length, SERIAL_WRITER_SLOT_SIZE);
+        std::memcpy(slot->data, data, slot->length);
+        data += slot->length;
+        length -= slot->length;
+        queue.publish();
+    }
+    framesQueued++;
+    maxDepth = std::max(maxDepth, queue.size());
+    // Pairs with the fence in run(): either the writer sees the new slot, or this sees that the writer is asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writerSleeping.load()) {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeCondition.notify_one();
+    }
+    return true;
+}
+
+void SerialWriter::run() {
+    while (true) {
+        Slot *slot = queue.front();
+        if (slot != nullptr) {
+            writeSlot(*slot);
+            queue.release();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        drainedCondition.notify_all();
+        if (!running.load()) {
+            return;
+        }
+        writerSleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queue.empty() && running.load()) {
+            // The timeout only guards against a missed wakeup; enqueue() normally wakes the writer immediately
+            wakeCondition.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        writerSleeping.store(false);
+    }
+}
+
+void SerialWriter::writeSlot(const Slot &slot) {
+    TRACE_SPAN("SerialWriter::writeSlot");
+    if (!writeFully(fd, slot.data, slot.length)) {
+        writeErrors++;
+        if (errorHandler) {
+            errorHandler();
+        }
+        return;
+    }
+    bytesWritten += (long) slot.length;
+}
+
+bool SerialWriter::flush(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    wakeCondition.notify_one();
+    return drainedCondition.wait_for(lock, timeout, [this]() { return queue.empty(); });
+}
+
+std::size_t SerialWriter::depth() const {
+    return queue.size();
+}
+
+SerialWriterStatistics SerialWriter::getStatistics() const {
+    SerialWriterStatistics statistics;
+    statistics.framesQueued = framesQueued;
+    statistics.bytesWritten = bytesWritten.load();
+    statistics.overflows = overflows;
+    statistics.writeErrors = writeErrors.load();
+    statistics.maxDepth = maxDepth;
+    return statistics;
+}
+
+SerialWriter::~SerialWriter() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        running.store(false);
+        wakeCondition.notify_one();
+    }
+    writerThread.join();
+}
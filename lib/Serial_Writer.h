@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Ring_Buffer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+/// @brief Largest number of bytes held by one queue slot. Longer frames are split across several slots.
+const std::size_t SERIAL_WRITER_SLOT_SIZE = 256;
+
+/// @brief Longest time a write may wait for a full device to accept more bytes before it counts as failed
+const std::chrono::milliseconds SERIAL_WRITE_TIMEOUT{1000};
+
+/// @brief Write all of a buffer to a file descriptor, retrying short and interrupted writes. When the descriptor is
+/// non-blocking and full, waits for it in poll() rather than retrying in a loop.
+/// @param timeout the longest time to wait for the descriptor to become writable each time it is full
+/// @return False if a write failed or the descriptor stayed full for the whole timeout (errno says which)
+bool writeFully(int fd, const char *data, std::size_t length, std::chrono::milliseconds timeout = SERIAL_WRITE_TIMEOUT);
+
+/// @brief Counters describing the serial writer's queue
+struct SerialWriterStatistics {
+    long framesQueued = 0;
+    long bytesWritten = 0;
+    long overflows = 0;
+    long writeErrors = 0;
+    std::size_t maxDepth = 0;
+};
+
+/// @brief Writes frames to a file descriptor on its own thread, so a slow write never stalls the thread producing the
+/// frames. Frames are passed through a lock-free single-producer/single-consumer queue: only one thread may call
+/// enqueue().
+class SerialWriter {
+private:
+    struct Slot {
+        std::size_t length;
+        char data[SERIAL_WRITER_SLOT_SIZE];
+    };
+
+    int fd;
+    std::ostream &errorLog;
+    std::function<void()> errorHandler;
+    RingBuffer<Slot> queue;
+    std::thread writerThread;
+    std::atomic<bool> running{true};
+    std::atomic<bool> writerSleeping{false};
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable drainedCondition;
+
+    // Written by the producer thread
+    long framesQueued = 0;
+    long overflows = 0;
+    bool overflowing = false;
+    std::size_t maxDepth = 0;
+    // Written by the writer thread
+    std::atomic<long> bytesWritten{0};
+    std::atomic<long> writeErrors{0};
+
+    void run();
+
+    /// @brief Write the whole slot to the file descriptor, calling the error handler if that fails
+    void writeSlot(const Slot &slot);
+
+public:
+    /// @param fd the file descriptor to write to. It is not closed by the writer.
+    /// @param capacity how many slots the queue holds before frames are dropped
+    /// @param errorLog where you want error messages to be logged
+    /// @param errorHandler called on the writer thread each time a write fails (e.g. to mark the connection lost)
+    SerialWriter(int fd, std::size_t capacity, std::ostream &errorLog, std::function<void()> errorHandler = nullptr);
+
+    SerialWriter(const SerialWriter &) = delete;
+
+    SerialWriter &operator=(const SerialWriter &) = delete;
+
+    /// @brief Queue a frame to be written. Never blocks: if the queue does not have room for the whole frame, the frame
+    /// is dropped and counted as an overflow.
+    /// @param data the bytes to write
+    /// @param length the number of bytes
+    /// @return True if the frame was queued
+    bool enqueue(const char *data, std::size_t length);
+
+    /// @brief Wait until every queued frame has been written
+    /// @param timeout the longest time to wait
+    /// @return True if the queue was drained in time
+    bool flush(std::chrono::milliseconds timeout);
+
+    /// @brief Number of slots waiting to be written
+    std::size_t depth() const;
+
+    SerialWriterStatistics getStatistics() const;
+
+    /// @brief Writes everything still queued, then stops the writer thread
+    ~SerialWriter();
+};
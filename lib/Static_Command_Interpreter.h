@@ -0,0 +1,166 @@
+#pragma once
+
+#include "Command.h"
+#include "Command_Interpreter.h"
+#include "Timing.h"
+#include "Wiring.h"
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <utility>
+
+/*
+ * A command interpreter whose pins are fixed at compile time. The wiring is described by types:
+ *
+ *     using Thrusters = PinBank<HardwarePwmThruster<4>, HardwarePwmThruster<5>, ...>;
+ *     using Outputs = PinBank<DigitalOutput<20, ActiveLow>>;
+ *     Static_Command_Interpreter<Thrusters, Outputs> interpreter(wiringControl, std::cerr);
+ *
+ * The number of thrusters, the GPIO numbers and pin reuse are all checked by the compiler, and every pin write is a
+ * direct (inlinable) call into WiringControl instead of a virtual call through a heap-allocated Pin. Use
+ * Command_Interpreter_RPi5 when the wiring is only known at runtime.
+ */
+
+/// @brief A thruster on a hardware pwm pin
+/// @tparam Gpio the Pico GPIO number for the pin (see https://pico.pinout.xyz/)
+template<int Gpio>
+struct HardwarePwmThruster {
+    static constexpr int gpioNumber = Gpio;
+    static constexpr PinType pinType = HardwarePWM;
+};
+
+/// @brief A thruster on a pin driven by software pwm
+/// @tparam Gpio the Pico GPIO number for the pin (see https://pico.pinout.xyz/)
+template<int Gpio>
+struct SoftwarePwmThruster {
+    static constexpr int gpioNumber = Gpio;
+    static constexpr PinType pinType = SoftwarePWM;
+};
+
+/// @brief A digital (two-state) output pin
+/// @tparam Gpio the Pico GPIO number for the pin (see https://pico.pinout.xyz/)
+/// @tparam Enable whether the pin is active high or active low
+template<int Gpio, EnableType Enable>
+struct DigitalOutput {
+    static constexpr int gpioNumber = Gpio;
+    static constexpr PinType pinType = Enable == ActiveHigh ? DigitalActiveHigh : DigitalActiveLow;
+};
+
+/// @brief An ordered list of pins
+template<typename... Pins>
+struct PinBank {
+    static constexpr std::size_t size = sizeof...(Pins);
+};
+
+/// @brief Whether every GPIO number is one the Pico has
+template<std::size_t N>
+constexpr bool gpioNumbersValid(const std::array<int, N> &gpioNumbers) {
+    for (std::size_t i = 0; i < N; i++) {
+        if (gpioNumbers[i] < 0 || gpioNumbers[i] >= PICO_GPIO_COUNT) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Whether no GPIO number appears twice
+template<std::size_t N>
+constexpr bool gpioNumbersUnique(const std::array<int, N> &gpioNumbers) {
+    for (std::size_t i = 0; i < N; i++) {
+        for (std::size_t j = i + 1; j < N; j++) {
+            if (gpioNumbers[i] == gpioNumbers[j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template<typename ThrusterBank, typename DigitalBank = PinBank<>>
+class Static_Command_Interpreter;
+
+/// @brief The purpose of this class is toggle the GPIO pins on the Pico based on a command object, with the wiring fixed
+/// at compile time.
+/// @tparam Thrusters the thruster pins, in the same order as the values of a pwm_array
+/// @tparam Digitals the digital output pins
+template<typename... Thrusters, typename... Digitals>
+class Static_Command_Interpreter<PinBank<Thrusters...>, PinBank<Digitals...>> {
+    static_assert(sizeof...(Thrusters) == THRUSTER_COUNT, "A command interpreter needs exactly THRUSTER_COUNT thruster pins");
+    static_assert(gpioNumbersValid(std::array<int, sizeof...(Thrusters) + sizeof...(Digitals)>{
+            {Thrusters::gpioNumber..., Digitals::gpioNumber...}}), "The Pico only has GPIO 0-29");
+    static_assert(gpioNumbersUnique(std::array<int, sizeof...(Thrusters) + sizeof...(Digitals)>{
+            {Thrusters::gpioNumber..., Digitals::gpioNumber...}}), "A GPIO pin is used more than once");
+
+private:
+    using ThrusterIndices = std::index_sequence_for<Thrusters...>;
+    using expand = int[];
+
+    WiringControl wiringControl;
+    std::ostream &errorLog;
+    CancellationToken cancellation;
+    HybridWaitStrategy waitStrategy;
+
+    template<std::size_t... I>
+    void sendThrusterPwms(const int *pulseWidths, std::index_sequence<I...>) {
+        (void) expand{0, (wiringControl.pwmWrite(Thrusters::gpioNumber, pulseWidths[I]), 0)...};
+    }
+
+    template<std::size_t... I>
+    std::array<int, sizeof...(Thrusters)> readThrusterPins(std::index_sequence<I...>) {
+        return std::array<int, sizeof...(Thrusters)>{{wiringControl.pwmRead(Thrusters::gpioNumber).pulseWidth...}};
+    }
+
+public:
+    /// @brief Number of thruster pins
+    static constexpr std::size_t thrusterCount = sizeof...(Thrusters);
+
+    /// @param wiringControl the connection to the Pico
+    /// @param errorLog where you want error messages to be logged
+    Static_Command_Interpreter(const WiringControl &wiringControl, std::ostream &errorLog)
+            : wiringControl(wiringControl), errorLog(errorLog) {}
+
+    /// @brief Sends the initialize commands to the Pico. All pins are configured in a single serial write.
+    /// @return False if the serial connection could not be opened
+    bool initializePins() {
+        if (!wiringControl.initializeSerial()) {
+            errorLog << "Failure to configure serial!" << std::endl;
+            return false;
+        }
+        wiringControl.beginFrame();
+        (void) expand{0, (wiringControl.setPinType(Thrusters::gpioNumber, Thrusters::pinType), 0)...,
+                      (wiringControl.setPinType(Digitals::gpioNumber, Digitals::pinType), 0)...};
+        wiringControl.endFrame();
+        return true;
+    }
+
+    /// @brief Sends the specified pwm values to the Pico, all in a single serial write
+    /// @param thrusterPwms one pwm value per thruster, in the order of the thruster bank
+    void untimed_execute(const pwm_array &thrusterPwms) {
+        wiringControl.beginFrame();
+        sendThrusterPwms(thrusterPwms.pwm_signals, ThrusterIndices{});
+        wiringControl.endFrame();
+    }
+
+    /// @brief Sets pwm values for the duration specified. Does not stop thrusters after execution.
+    /// @param command the pwm values and how long to keep them
+    void blind_execute(const CommandComponent &command) {
+        cancellation.reset();
+        auto endTime = MonotonicClock::now() + command.duration;
+        untimed_execute(command.thruster_pwms);
+        waitStrategy.wait(endTime, cancellation);
+        cancellation.reset();
+    }
+
+    /// @brief Stop a running blind_execute early. Safe to call from any thread.
+    void interruptBlind_Execute() { cancellation.cancel(); }
+
+    /// @brief Get the current pwm values of the thrusters.
+    std::array<int, sizeof...(Thrusters)> readThrusterPins() {
+        return readThrusterPins(ThrusterIndices{});
+    }
+
+    /// @brief Get the current values of the digital pins (1 for high, 0 for low)
+    std::array<int, sizeof...(Digitals)> readDigitalPins() {
+        return std::array<int, sizeof...(Digitals)>{{(int) wiringControl.digitalRead(Digitals::gpioNumber)...}};
+    }
+};
@@ -0,0 +1,223 @@
+#include "Stream_Controller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+StreamController::StreamController(Command_Interpreter_RPi5 &interpreter, int rateHz, std::ostream &errorLog)
+        : interpreter(interpreter), errorLog(errorLog), waitStrategy(new SleepWaitStrategy()), segmentStartOutput{},
+          output{} {
+    if (rateHz < 1 || rateHz > 1000) {
+        errorLog << "Stream rate must be between 1 and 1000 Hz, not " << rateHz << "! Exiting." << std::endl;
+        exit(42);
+    }
+    period = std::chrono::nanoseconds(1000000000LL / rateHz);
+    double maximumRate = interpreter.getMaximumUpdateRate();
+    if (maximumRate > 0 && rateHz > maximumRate) {
+        errorLog << "Warning: a stream rate of " << rateHz << " Hz is more than the serial link can carry (at most "
+                 << (int) maximumRate << " updates per second at " << interpreter.getLinkBudget().baud
+                 << " baud). Lower the rate or enable the adaptive rate." << std::endl;
+    }
+    std::array<int, THRUSTER_COUNT> current = interpreter.readThrusterPins();
+    for (std::size_t i = 0; i < current.size(); i++) {
+        output.pwm_signals[i] = current[i];
+    }
+    segmentStartOutput = output;
+    segmentStart = MonotonicClock::now();
+    stopsSeen = interpreter.getStopStatistics().stops;
+}
+
+void StreamController::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    cancellation.reset();
+    loopThread = std::thread(&StreamController::run, this);
+}
+
+bool StreamController::setWaitStrategy(std::unique_ptr<WaitStrategy> strategy) {
+    if (running.load()) {
+        errorLog << "Cannot change the wait strategy of a running stream!" << std::endl;
+        return false;
+    }
+    waitStrategy = std::move(strategy);
+    return true;
+}
+
+void StreamController::stop() {
+    running.store(false);
+    cancellation.cancel();
+    if (loopThread.joinable()) {
+        loopThread.join();
+    }
+}
+
+bool StreamController::pushSegment(const pwm_array &target, std::chrono::nanoseconds ramp,
+                                   std::chrono::nanoseconds hold) {
+    if (segmentCount == STREAM_MAX_SEGMENTS) {
+        errorLog << "Stream segment queue full, dropping segment!" << std::endl;
+        return false;
+    }
+    segments[(firstSegment + segmentCount) % STREAM_MAX_SEGMENTS] = Segment{target, ramp, hold};
+    segmentCount++;
+    return true;
+}
+
+void StreamController::restartFromCurrentOutput(MonotonicClock::time_point now) {
+    segmentStartOutput = outputAt(now);
+    segmentStart = now;
+    segmentCount = 0;
+    if (halted) {
+        // A new setpoint after an emergency stop starts from neutral and acknowledges the stop
+        halted = false;
+        stopsSeen = interpreter.getStopStatistics().stops;
+    }
+}
+
+void StreamController::setTarget(const pwm_array &target, std::chrono::milliseconds ramp) {
+    std::lock_guard<std::mutex> lock(mutex);
+    restartFromCurrentOutput(MonotonicClock::now());
+    pushSegment(target, ramp, std::chrono::nanoseconds(0));
+}
+
+void StreamController::execute(const Command &command) {
+    std::lock_guard<std::mutex> lock(mutex);
+    restartFromCurrentOutput(MonotonicClock::now());
+    pushSegment(command.acceleration.thruster_pwms, command.acceleration.duration, std::chrono::nanoseconds(0));
+    pushSegment(command.steadyState.thruster_pwms, std::chrono::nanoseconds(0), command.steadyState.duration);
+    pushSegment(command.deceleration.thruster_pwms, command.deceleration.duration, std::chrono::nanoseconds(0));
+}
+
+void StreamController::setAdaptiveRate(bool enabled, double target) {
+    std::lock_guard<std::mutex> lock(mutex);
+    adaptive = enabled;
+    targetUtilization = target;
+    if (!enabled) {
+        statistics.decimation = 1;
+    }
+}
+
+int StreamController::adaptiveDecimation() const {
+    LinkBudgetStatistics budget = interpreter.getLinkBudget();
+    if (budget.capacity <= 0 || budget.meanFrameBytes <= 0 || targetUtilization <= 0) {
+        return 1;
+    }
+    double allowedRate = targetUtilization * budget.capacity / budget.meanFrameBytes;
+    double rate = 1e9 / (double) period.count();
+    return std::max(1, (int) std::ceil(rate / allowedRate));
+}
+
+pwm_array StreamController::outputAt(MonotonicClock::time_point now) {
+    if (halted) {
+        return output;
+    }
+    while (segmentCount > 0) {
+        const Segment &segment = segments[firstSegment];
+        auto segmentEnd = segmentStart + segment.ramp + segment.hold;
+        if (now < segmentEnd) {
+            break;
+        }
+        // Chain from the segment's scheduled end, so the tick rate never stretches a command
+        segmentStartOutput = segment.target;
+        segmentStart = segmentEnd;
+        firstSegment = (firstSegment + 1) % STREAM_MAX_SEGMENTS;
+        segmentCount--;
+    }
+    if (segmentCount == 0) {
+        return segmentStartOutput;
+    }
+    const Segment &segment = segments[firstSegment];
+    float progress = 1.0f;
+    if (now < segmentStart + segment.ramp) {
+        progress = (float) (now - segmentStart).count() / (float) segment.ramp.count();
+    }
+    pwm_array result{};
+    for (int i = 0; i < THRUSTER_COUNT; i++) {
+        int start = segmentStartOutput.pwm_signals[i];
+        int end = segment.target.pwm_signals[i];
+        result.pwm_signals[i] = start + (int) std::lround((float) (end - start) * progress);
+    }
+    return result;
+}
+
+void StreamController::run() {
+    auto deadline = MonotonicClock::now();
+    while (running.load()) {
+        pwm_array next;
+        long stops;
+        bool send;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            next = outputAt(MonotonicClock::now());
+            stops = stopsSeen;
+            send = !halted;
+            if (adaptive) {
+                statistics.decimation = adaptiveDecimation();
+                if (tickIndex++ % statistics.decimation != 0) {
+                    statistics.decimatedTicks++;
+                    send = false;
+                }
+            }
+        }
+        if (send) {
+            if (interpreter.stream_execute(next, stops)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                output = next;
+                statistics.ticks++;
+                if (segmentCount == 0) {
+                    settled.notify_all();
+                }
+            } else {
+                // The interpreter has set every thruster to neutral: stay there until the next setpoint
+                std::lock_guard<std::mutex> lock(mutex);
+                halted = true;
+                segmentCount = 0;
+                for (int &pwm: output.pwm_signals) {
+                    pwm = 1500;
+                }
+                segmentStartOutput = output;
+                statistics.stops++;
+                settled.notify_all();
+            }
+        }
+
+        deadline += period;
+        auto now = MonotonicClock::now();
+        if (now - deadline > period) {
+            // Too far behind to catch up: skip the missed ticks rather than sending a burst
+            auto missed = (now - deadline) / period;
+            std::lock_guard<std::mutex> lock(mutex);
+            statistics.missedTicks += (long) missed;
+            deadline += missed * period;
+        }
+        if (!waitStrategy->wait(deadline, cancellation)) {
+            break;
+        }
+        auto lateness = std::chrono::duration_cast<std::chrono::nanoseconds>(MonotonicClock::now() - deadline);
+        std::lock_guard<std::mutex> lock(mutex);
+        statistics.maxLateness = std::max(statistics.maxLateness, lateness);
+    }
+}
+
+bool StreamController::waitUntilSettled(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return settled.wait_for(lock, timeout, [this]() {
+        return segmentCount == 0 && (halted || std::equal(std::begin(output.pwm_signals),
+                                                          std::end(output.pwm_signals),
+                                                          std::begin(segmentStartOutput.pwm_signals)));
+    });
+}
+
+pwm_array StreamController::getOutput() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return output;
+}
+
+StreamStatistics StreamController::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+StreamController::~StreamController() {
+    stop();
+}
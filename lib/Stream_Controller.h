@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Command.h"
+#include "Command_Interpreter.h"
+#include "Timing.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+/// @brief Most ramp segments that can be queued at once
+const std::size_t STREAM_MAX_SEGMENTS = 16;
+
+/// @brief How the streaming loop has kept to its rate
+struct StreamStatistics {
+    /// @brief Updates sent to the Pico
+    long ticks = 0;
+    /// @brief Ticks skipped because the loop fell more than a whole period behind
+    long missedTicks = 0;
+    /// @brief Times the stream was halted by an emergency stop
+    long stops = 0;
+    /// @brief How late the loop woke up compared to each tick's deadline
+    std::chrono::nanoseconds maxLateness{0};
+    /// @brief Ticks not sent because the adaptive rate was keeping the link below its target utilization
+    long decimatedTicks = 0;
+    /// @brief Only every decimation-th tick is currently sent (1 unless the adaptive rate is throttling)
+    int decimation = 1;
+};
+
+/// @brief Sends thruster pwm values at a fixed rate on its own thread, ramping linearly between setpoints instead of
+/// stepping. New setpoints can be given at any time; the ramp to them starts from whatever is being output at that
+/// moment. An emergency stop on the interpreter halts the stream until the next setpoint.
+class StreamController {
+private:
+    /// @brief Ramp from the previous output to target over ramp, then hold target for hold
+    struct Segment {
+        pwm_array target;
+        std::chrono::nanoseconds ramp;
+        std::chrono::nanoseconds hold;
+    };
+
+    Command_Interpreter_RPi5 &interpreter;
+    std::ostream &errorLog;
+    std::chrono::nanoseconds period;
+    std::unique_ptr<WaitStrategy> waitStrategy;
+    CancellationToken cancellation;
+    std::thread loopThread;
+    std::atomic<bool> running{false};
+
+    mutable std::mutex mutex;
+    std::condition_variable settled;
+    Segment segments[STREAM_MAX_SEGMENTS];
+    std::size_t segmentCount = 0;
+    std::size_t firstSegment = 0;
+    /// @brief The output when the current segment started
+    pwm_array segmentStartOutput;
+    MonotonicClock::time_point segmentStart;
+    /// @brief The most recent output
+    pwm_array output;
+    bool halted = false;
+    long stopsSeen = 0;
+    bool adaptive = false;
+    double targetUtilization = 0;
+    long tickIndex = 0;
+    StreamStatistics statistics;
+
+    void run();
+
+    /// @brief The output at the given time, retiring finished segments. The mutex must be held.
+    pwm_array outputAt(MonotonicClock::time_point now);
+
+    /// @brief Drop every queued segment and start the next from the current output. The mutex must be held.
+    void restartFromCurrentOutput(MonotonicClock::time_point now);
+
+    /// @brief Queue a segment. The mutex must be held.
+    bool pushSegment(const pwm_array &target, std::chrono::nanoseconds ramp, std::chrono::nanoseconds hold);
+
+    /// @brief The n for which sending every n-th tick keeps the link at the target utilization, given its recent
+    /// frame sizes. The mutex must be held.
+    int adaptiveDecimation() const;
+
+public:
+    /// @param interpreter the interpreter whose thrusters are driven. Its pins must already be initialized.
+    /// @param rateHz how many updates to send per second, between 1 and 1000. A warning is logged if the serial link
+    /// cannot carry this many thruster updates per second.
+    /// @param errorLog where you want error messages to be logged
+    StreamController(Command_Interpreter_RPi5 &interpreter, int rateHz, std::ostream &errorLog);
+
+    StreamController(const StreamController &) = delete;
+
+    StreamController &operator=(const StreamController &) = delete;
+
+    /// @brief Start sending updates
+    void start();
+
+    /// @brief Stop sending updates. Thrusters keep their last values.
+    void stop();
+
+    /// @brief Ramp to new pwm values, replacing anything queued
+    /// @param target the pwm values to reach
+    /// @param ramp how long the ramp takes (zero for a step)
+    void setTarget(const pwm_array &target, std::chrono::milliseconds ramp);
+
+    /// @brief Run a command as ramps, replacing anything queued: ramp to the acceleration values over the acceleration
+    /// duration, hold the steady-state values for the steady-state duration, then ramp to the deceleration values over
+    /// the deceleration duration. The deceleration values are held afterwards.
+    /// @param command the command to run
+    void execute(const Command &command);
+
+    /// @brief Send only every n-th tick when the link would otherwise go over the target utilization, choosing n from
+    /// the link's baud rate and recent frame sizes. Ramps keep their timing; they are just sampled more coarsely.
+    /// @param enabled whether to adapt the rate
+    /// @param target the fraction of the link's capacity the stream may use, between 0 and 1
+    void setAdaptiveRate(bool enabled, double target = 0.8);
+
+    /// @brief Choose how the stream waits for each tick. Defaults to a SleepWaitStrategy: a tick a few tens of
+    /// microseconds late is harmless to a ramp, so the stream does not spin a core the way blind_execute can.
+    /// @param strategy the wait strategy to use from the next start() on
+    /// @return False (and the strategy is not used) if the stream is running
+    bool setWaitStrategy(std::unique_ptr<WaitStrategy> strategy);
+
+    /// @brief Wait until every queued segment has finished
+    /// @param timeout the longest time to wait
+    /// @return True if the stream reached its final target in time
+    bool waitUntilSettled(std::chrono::milliseconds timeout);
+
+    /// @brief The values most recently sent
+    pwm_array getOutput() const;
+
+    StreamStatistics getStatistics() const;
+
+    ~StreamController();
+};
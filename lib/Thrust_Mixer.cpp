@@ -0,0 +1,154 @@
+#include "Thrust_Mixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/// @brief The pulse width at a force, interpolating linearly between the measured points and saturating at the ends
+static float interpolateCurve(const std::vector<ThrustCurvePoint> &points, float force) {
+    if (force <= points.front().force) {
+        return points.front().pulseWidth;
+    }
+    for (std::size_t i = 1; i < points.size(); i++) {
+        if (force <= points[i].force) {
+            const ThrustCurvePoint &low = points[i - 1];
+            const ThrustCurvePoint &high = points[i];
+            float fraction = (force - low.force) / (high.force - low.force);
+            return low.pulseWidth + fraction * (high.pulseWidth - low.pulseWidth);
+        }
+    }
+    return points.back().pulseWidth;
+}
+
+ThrustCurve::ThrustCurve(const std::vector<ThrustCurvePoint> &points) {
+    if (points.size() < 2) {
+        std::cerr << "A thrust curve needs at least two points! Exiting." << std::endl;
+        exit(42);
+    }
+    minimumForce = points.front().force;
+    maximumForce = points.back().force;
+    neutralPulseWidth = interpolateCurve(points, 0.0f);
+    reverseScale = resample(points, -1.0f, reverseTable);
+    forwardScale = resample(points, 1.0f, forwardTable);
+}
+
+float ThrustCurve::resample(const std::vector<ThrustCurvePoint> &points, float direction, float *table) {
+    float span = std::max(0.0f, direction > 0 ? points.back().force : -points.front().force);
+    float step = span / THRUST_CURVE_SEGMENTS;
+    for (int i = 0; i <= THRUST_CURVE_SEGMENTS; i++) {
+        table[i] = interpolateCurve(points, direction * step * (float) i);
+    }
+    if (span == 0) {
+        return 0;
+    }
+    // The nearest point on this side within the first step is the edge of the deadband: start the grid there, so the
+    // jump out of the deadband is not spread across the step
+    float nearest = step;
+    for (const ThrustCurvePoint &point: points) {
+        float distance = direction * point.force;
+        if (distance > 0 && distance <= nearest) {
+            nearest = distance;
+            table[0] = point.pulseWidth;
+        }
+    }
+    return 1.0f / step;
+}
+
+ThrustCurve ThrustCurve::t200() {
+    // Forces in newtons at 16 V, read off the published T200 performance chart
+    return ThrustCurve({{-40.0f, 1100}, {-26.0f, 1200}, {-13.5f, 1300}, {-4.0f, 1400}, {-0.01f, 1464},
+                        {0.0f, 1500}, {0.01f, 1536}, {5.0f, 1600}, {17.0f, 1700}, {33.0f, 1800}, {51.5f, 1900}});
+}
+
+int ThrustCurve::pulseWidth(float force) const {
+    force = std::min(maximumForce, std::max(minimumForce, force));
+    if (force == 0) {
+        return (int) std::lround(neutralPulseWidth);
+    }
+    const float *table = force > 0 ? forwardTable : reverseTable;
+    float position = std::fabs(force) * (force > 0 ? forwardScale : reverseScale);
+    position = std::min((float) THRUST_CURVE_SEGMENTS, position);
+    int index = std::min((int) position, THRUST_CURVE_SEGMENTS - 1);
+    float fraction = position - (float) index;
+    return (int) std::lround(table[index] + fraction * (table[index + 1] - table[index]));
+}
+
+ThrustMixer::ThrustMixer(const float allocationMatrix[MIXER_THRUSTER_COUNT][WRENCH_AXES], const ThrustCurve &curve) {
+    for (int axis = 0; axis < WRENCH_AXES; axis++) {
+        for (int thruster = 0; thruster < MIXER_THRUSTER_COUNT; thruster++) {
+            allocation[axis][thruster] = allocationMatrix[thruster][axis];
+        }
+    }
+    for (int thruster = 0; thruster < MIXER_THRUSTER_COUNT; thruster++) {
+        setCurve(thruster, curve);
+    }
+}
+
+void ThrustMixer::setCurve(int thruster, const ThrustCurve &curve) {
+    if (thruster < 0 || thruster >= MIXER_THRUSTER_COUNT) {
+        std::cerr << "Invalid thruster " << thruster << ", the mixer only has " << MIXER_THRUSTER_COUNT
+                  << " thrusters! Exiting." << std::endl;
+        exit(42);
+    }
+    inverseMinimumForces[thruster] = curve.minimumForce < 0 ? 1.0f / curve.minimumForce : 0.0f;
+    inverseMaximumForces[thruster] = curve.maximumForce > 0 ? 1.0f / curve.maximumForce : 0.0f;
+    neutralPulseWidths[thruster] = curve.neutralPulseWidth;
+    reverseScales[thruster] = curve.reverseScale;
+    forwardScales[thruster] = curve.forwardScale;
+    std::copy(std::begin(curve.reverseTable), std::end(curve.reverseTable), std::begin(reverseTables[thruster]));
+    std::copy(std::begin(curve.forwardTable), std::end(curve.forwardTable), std::begin(forwardTables[thruster]));
+}
+
+void ThrustMixer::allocate(const Wrench &wrench, force_array &forces) const {
+    float *out = forces.forces;
+    for (int thruster = 0; thruster < MIXER_THRUSTER_COUNT; thruster++) {
+        out[thruster] = 0.0f;
+    }
+    for (int axis = 0; axis < WRENCH_AXES; axis++) {
+        const float amount = wrench.axes[axis];
+        const float *column = allocation[axis];
+        for (int thruster = 0; thruster < MIXER_THRUSTER_COUNT; thruster++) {
+            out[thruster] += amount * column[thruster];
+        }
+    }
+}
+
+float ThrustMixer::forcesToPwm(const force_array &forces, pwm_array &pwms) const {
+    const float *in = forces.forces;
+
+    // How far past its limit the most saturated thruster is, in either direction
+    float ratios[MIXER_THRUSTER_COUNT];
+    for (int thruster = 0; thruster < MIXER_THRUSTER_COUNT; thruster++) {
+        ratios[thruster] = std::max(in[thruster] * inverseMaximumForces[thruster],
+                                    in[thruster] * inverseMinimumForces[thruster]);
+    }
+    float worst = 1.0f;
+    for (float ratio: ratios) {
+        worst = std::max(worst, ratio);
+    }
+    const float scale = 1.0f / worst;
+
+    float positions[MIXER_THRUSTER_COUNT];
+    for (int thruster = 0; thruster < MIXER_THRUSTER_COUNT; thruster++) {
+        float force = in[thruster] * scale;
+        float position = std::fabs(force) * (force > 0 ? forwardScales[thruster] : reverseScales[thruster]);
+        positions[thruster] = std::min((float) THRUST_CURVE_SEGMENTS, position);
+    }
+    for (int thruster = 0; thruster < MIXER_THRUSTER_COUNT; thruster++) {
+        float force = in[thruster] * scale;
+        int index = std::min((int) positions[thruster], THRUST_CURVE_SEGMENTS - 1);
+        float fraction = positions[thruster] - (float) index;
+        const float *table = force > 0 ? forwardTables[thruster] : reverseTables[thruster];
+        float pulseWidth = table[index] + fraction * (table[index + 1] - table[index]);
+        pwms.pwm_signals[thruster] = (int) std::lround(force == 0 ? neutralPulseWidths[thruster] : pulseWidth);
+    }
+    return worst;
+}
+
+pwm_array ThrustMixer::mix(const Wrench &wrench) const {
+    force_array forces{};
+    allocate(wrench, forces);
+    pwm_array pwms{};
+    forcesToPwm(forces, pwms);
+    return pwms;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Command.h"
+#include <vector>
+
+/// @brief Number of thrusters the mixer drives (the length of a force_array or pwm_array)
+const int MIXER_THRUSTER_COUNT = THRUSTER_COUNT;
+
+/// @brief Number of degrees of freedom in a wrench
+const int WRENCH_AXES = 6;
+
+/// @brief Number of equal-width segments each side (reverse and forward) of a thruster curve is resampled into
+const int THRUST_CURVE_SEGMENTS = 128;
+
+/// @brief The components of a wrench, in order
+enum WrenchAxis {
+    Surge, Sway, Heave, Roll, Pitch, Yaw
+};
+
+/// @brief A desired force and torque on the vehicle: forces (N) along surge, sway and heave, then torques (N m) about
+/// roll, pitch and yaw
+struct Wrench {
+    float axes[WRENCH_AXES];
+};
+
+/// @brief One measured point of a thruster's response
+struct ThrustCurvePoint {
+    /// @brief Thrust in newtons (negative for reverse)
+    float force;
+    /// @brief Pulse width in microseconds that produces the thrust
+    float pulseWidth;
+};
+
+/// @brief Maps a thruster's thrust to the pulse width that produces it. The measured points are resampled onto two
+/// uniform grids, one for reverse and one for forward thrust, so that a lookup is a multiply, a clamp and one linear
+/// interpolation, with no search. Both grids start at zero thrust. A point closer to zero than one grid step is taken
+/// as the edge of the deadband: its grid starts from that point's pulse width, so any nonzero force clears the
+/// deadband, while exactly zero thrust gives the neutral pulse width.
+class ThrustCurve {
+private:
+    float minimumForce;
+    float maximumForce;
+    /// @brief The pulse width for exactly zero thrust
+    float neutralPulseWidth;
+    /// @brief Grid points per newton of reverse thrust, or 0 if the curve has none
+    float reverseScale;
+    /// @brief Grid points per newton of forward thrust, or 0 if the curve has none
+    float forwardScale;
+    /// @brief reverseTable[i] is the pulse width for a thrust of -i / reverseScale
+    float reverseTable[THRUST_CURVE_SEGMENTS + 1];
+    /// @brief forwardTable[i] is the pulse width for a thrust of i / forwardScale
+    float forwardTable[THRUST_CURVE_SEGMENTS + 1];
+
+    /// @brief Resample one side of the curve
+    /// @param points the measured points
+    /// @param direction 1 for forward thrust, -1 for reverse thrust
+    /// @param table filled with the grid
+    /// @return The grid points per newton, or 0 if the curve has no thrust in that direction
+    static float resample(const std::vector<ThrustCurvePoint> &points, float direction, float *table);
+
+    friend class ThrustMixer;
+
+public:
+    /// @param points at least two points, sorted by increasing force and pulse width
+    explicit ThrustCurve(const std::vector<ThrustCurvePoint> &points);
+
+    /// @brief Approximate response of a Blue Robotics T200 at 16 V, with its 1464-1536 us deadband centred on 1500 us
+    static ThrustCurve t200();
+
+    /// @brief Largest reverse thrust (a negative number)
+    float getMinimumForce() const { return minimumForce; }
+
+    /// @brief Largest forward thrust
+    float getMaximumForce() const { return maximumForce; }
+
+    /// @brief The pulse width for a thrust, saturating at the ends of the curve
+    int pulseWidth(float force) const;
+};
+
+/// @brief Turns a desired wrench into thruster pulse widths. The wrench is first allocated to per-thruster forces through
+/// an allocation matrix (typically the pseudo-inverse of the thruster geometry); if any thruster would saturate, all
+/// forces are scaled down together so the direction of the wrench is kept; then each force goes through its thruster's
+/// curve. Every step is a fixed-length loop over the thrusters on contiguous floats, which compilers vectorize.
+class ThrustMixer {
+private:
+    /// @brief Allocation matrix stored axis-major, so each axis contributes one thruster-wide multiply-add
+    alignas(32) float allocation[WRENCH_AXES][MIXER_THRUSTER_COUNT];
+    /// @brief Reciprocals of the force limits, or 0 where a thruster cannot push in that direction at all
+    alignas(32) float inverseMinimumForces[MIXER_THRUSTER_COUNT];
+    alignas(32) float inverseMaximumForces[MIXER_THRUSTER_COUNT];
+    alignas(32) float neutralPulseWidths[MIXER_THRUSTER_COUNT];
+    alignas(32) float reverseScales[MIXER_THRUSTER_COUNT];
+    alignas(32) float forwardScales[MIXER_THRUSTER_COUNT];
+    alignas(32) float reverseTables[MIXER_THRUSTER_COUNT][THRUST_CURVE_SEGMENTS + 1];
+    alignas(32) float forwardTables[MIXER_THRUSTER_COUNT][THRUST_CURVE_SEGMENTS + 1];
+
+public:
+    /// @param allocationMatrix row i gives thruster i's force (N) per unit of each wrench axis
+    /// @param curve the thrust curve used for every thruster
+    ThrustMixer(const float allocationMatrix[MIXER_THRUSTER_COUNT][WRENCH_AXES], const ThrustCurve &curve);
+
+    /// @brief Use a different curve for one thruster (e.g. a thruster mounted in reverse, or a different model)
+    /// @param thruster the index of the thruster, in pwm_array order
+    /// @param curve the thruster's curve
+    void setCurve(int thruster, const ThrustCurve &curve);
+
+    /// @brief Distribute a wrench across the thrusters
+    /// @param wrench the desired wrench
+    /// @param forces filled with each thruster's force, before saturation
+    void allocate(const Wrench &wrench, force_array &forces) const;
+
+    /// @brief Convert thruster forces to pulse widths. Forces beyond what a thruster can produce are scaled down
+    /// together, keeping their ratios. A force in a direction a thruster cannot push at all (its curve ends at zero)
+    /// does not scale the others; it just saturates.
+    /// @param forces each thruster's force
+    /// @param pwms filled with each thruster's pulse width
+    /// @return The factor the forces were scaled down by (1 if no thruster saturated)
+    float forcesToPwm(const force_array &forces, pwm_array &pwms) const;
+
+    /// @brief allocate() followed by forcesToPwm()
+    /// @param wrench the desired wrench
+    /// @return A pulse width for each thruster
+    pwm_array mix(const Wrench &wrench) const;
+};
@@ -0,0 +1,77 @@
+#include "Timing.h"
+
+#include <algorithm>
+
+std::chrono::nanoseconds WaitStatistics::meanOvershoot() const {
+    long completed = waits - interrupted;
+    if (completed == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    return totalOvershoot / completed;
+}
+
+void WaitStatistics::record(std::chrono::nanoseconds overshoot) {
+    waits++;
+    lastOvershoot = overshoot;
+    maxOvershoot = std::max(maxOvershoot, overshoot);
+    totalOvershoot += overshoot;
+}
+
+void CancellationToken::cancel() {
+    cancelTime.store(MonotonicClock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex);
+    cancelled.store(true, std::memory_order_release);
+    condition.notify_all();
+}
+
+void CancellationToken::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    cancelled.store(false, std::memory_order_release);
+}
+
+MonotonicClock::time_point CancellationToken::cancelledAt() const {
+    return MonotonicClock::time_point(MonotonicClock::duration(cancelTime.load(std::memory_order_relaxed)));
+}
+
+bool CancellationToken::sleepUntil(MonotonicClock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return condition.wait_until(lock, deadline, [this]() { return isCancelled(); });
+}
+
+bool WaitStrategy::wait(MonotonicClock::time_point deadline, CancellationToken &cancellation) {
+    waitUntil(deadline, cancellation);
+    auto now = MonotonicClock::now();
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    if (now < deadline) {
+        statistics.waits++;
+        statistics.interrupted++;
+        return false;
+    }
+    statistics.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline));
+    return true;
+}
+
+WaitStatistics WaitStrategy::getStatistics() const {
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    return statistics;
+}
+
+void WaitStrategy::resetStatistics() {
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    statistics = WaitStatistics{};
+}
+
+void BusyWaitStrategy::waitUntil(MonotonicClock::time_point deadline, CancellationToken &cancellation) {
+    while (MonotonicClock::now() < deadline && !cancellation.isCancelled()) {}
+}
+
+void SleepWaitStrategy::waitUntil(MonotonicClock::time_point deadline, CancellationToken &cancellation) {
+    cancellation.sleepUntil(deadline);
+}
+
+void HybridWaitStrategy::waitUntil(MonotonicClock::time_point deadline, CancellationToken &cancellation) {
+    if (cancellation.sleepUntil(deadline - spinThreshold)) {
+        return;
+    }
+    while (MonotonicClock::now() < deadline && !cancellation.isCancelled()) {}
+}
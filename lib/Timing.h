@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+/// @brief Clock used for all command deadlines. Unlike the system clock, it is never stepped by NTP.
+using MonotonicClock = std::chrono::steady_clock;
+
+/// @brief A thread-safe request to stop a running command. Any thread may cancel the token; a thread sleeping in
+/// sleepUntil() is woken immediately instead of at its next poll.
+class CancellationToken {
+private:
+    std::atomic<bool> cancelled{false};
+    std::atomic<MonotonicClock::rep> cancelTime{0};
+    std::mutex mutex;
+    std::condition_variable condition;
+public:
+    /// @brief Request cancellation and wake every thread waiting on the token
+    void cancel();
+
+    /// @brief Clear a previous cancellation so the token can be reused
+    void reset();
+
+    /// @brief Whether cancel() has been called since the last reset()
+    bool isCancelled() const { return cancelled.load(std::memory_order_acquire); }
+
+    /// @brief When cancel() was last called
+    MonotonicClock::time_point cancelledAt() const;
+
+    /// @brief Sleep until the deadline or until the token is cancelled, whichever comes first
+    /// @param deadline the time to wake up
+    /// @return True if the token was cancelled
+    bool sleepUntil(MonotonicClock::time_point deadline);
+};
+
+/// @brief How late deadline waits have woken up
+struct WaitStatistics {
+    long waits = 0;
+    long interrupted = 0;
+    std::chrono::nanoseconds lastOvershoot{0};
+    std::chrono::nanoseconds maxOvershoot{0};
+    std::chrono::nanoseconds totalOvershoot{0};
+
+    /// @brief Average overshoot of the waits that reached their deadline
+    std::chrono::nanoseconds meanOvershoot() const;
+
+    /// @brief Add a completed wait to the statistics
+    /// @param overshoot how long after the deadline the wait returned
+    void record(std::chrono::nanoseconds overshoot);
+};
+
+/// @brief A way of waiting for a deadline. Implementations trade CPU use against how close to the deadline they wake up.
+class WaitStrategy {
+private:
+    mutable std::mutex statisticsMutex;
+    WaitStatistics statistics;
+
+protected:
+    /// @brief Wait until the deadline has passed or the token is cancelled
+    virtual void waitUntil(MonotonicClock::time_point deadline, CancellationToken &cancellation) = 0;
+
+public:
+    /// @brief Wait until the deadline has passed or the token is cancelled, recording the overshoot
+    /// @param deadline the time to wake up
+    /// @param cancellation a token that ends the wait early when cancelled (possibly by another thread)
+    /// @return True if the deadline was reached, false if the wait was cancelled
+    bool wait(MonotonicClock::time_point deadline, CancellationToken &cancellation);
+
+    /// @brief Overshoot statistics of every wait made through this strategy. Safe to call while another thread waits.
+    WaitStatistics getStatistics() const;
+
+    void resetStatistics();
+
+    virtual ~WaitStrategy() = default;
+};
+
+/// @brief Spins on the clock. Most precise, but keeps a core fully busy for the whole wait.
+class BusyWaitStrategy : public WaitStrategy {
+protected:
+    void waitUntil(MonotonicClock::time_point deadline, CancellationToken &cancellation) override;
+};
+
+/// @brief Sleeps on the monotonic clock (a futex wait with an absolute CLOCK_MONOTONIC deadline on Linux). Uses almost
+/// no CPU, but wakes up as late as the kernel's timer slack.
+class SleepWaitStrategy : public WaitStrategy {
+protected:
+    void waitUntil(MonotonicClock::time_point deadline, CancellationToken &cancellation) override;
+};
+
+/// @brief Sleeps until shortly before the deadline, then spins for the remainder. Near-zero CPU use with the precision of
+/// a busy wait.
+class HybridWaitStrategy : public SleepWaitStrategy {
+private:
+    std::chrono::nanoseconds spinThreshold;
+protected:
+    void waitUntil(MonotonicClock::time_point deadline, CancellationToken &cancellation) override;
+
+public:
+    /// @param spinThreshold how long before the deadline to stop sleeping and start spinning
+    explicit HybridWaitStrategy(std::chrono::nanoseconds spinThreshold = std::chrono::microseconds(200))
+            : spinThreshold(spinThreshold) {}
+};
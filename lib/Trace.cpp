@@ -0,0 +1,172 @@
+#include "Trace.h"
+
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+    struct TraceEvent {
+        const char *name;
+        int64_t start;
+        int64_t duration;
+    };
+
+    /// @brief The spans of one thread. Only that thread writes; count is published with release ordering so the
+    /// exporter can read the events before it without a lock.
+    struct ThreadTraceBuffer {
+        int threadId;
+        std::size_t capacity;
+        // Left uninitialized, so pages the thread never records into are never touched
+        std::unique_ptr<TraceEvent[]> events;
+        std::atomic<std::size_t> count{0};
+        std::atomic<long> dropped{0};
+        // Guarded by registryMutex
+        bool finished = false;
+
+        ThreadTraceBuffer(int threadId, std::size_t capacity)
+                : threadId(threadId), capacity(capacity), events(new TraceEvent[capacity]) {}
+    };
+
+    std::mutex registryMutex;
+    // Buffers outlive their threads so that spans from finished threads can still be exported
+    std::vector<std::shared_ptr<ThreadTraceBuffer>> registry;
+    // Buffers of finished threads whose spans have been exported, ready for new threads
+    std::vector<std::shared_ptr<ThreadTraceBuffer>> freeBuffers;
+    int nextThreadId = 1;
+    long droppedByRecycledBuffers = 0;
+    std::atomic<std::size_t> bufferCapacity{TRACE_BUFFER_CAPACITY};
+
+    /// @brief Move the buffers of finished threads from the registry to the free list. The registry mutex must be held.
+    void recycleFinishedBuffers() {
+        std::size_t capacity = bufferCapacity.load();
+        auto live = registry.begin();
+        for (auto &buffer: registry) {
+            if (!buffer->finished) {
+                *live++ = std::move(buffer);
+                continue;
+            }
+            droppedByRecycledBuffers += buffer->dropped.load(std::memory_order_relaxed);
+            if (buffer->capacity == capacity) {
+                buffer->count.store(0, std::memory_order_relaxed);
+                buffer->dropped.store(0, std::memory_order_relaxed);
+                buffer->finished = false;
+                freeBuffers.push_back(std::move(buffer));
+            }
+        }
+        registry.erase(live, registry.end());
+    }
+
+    /// @brief Owns the calling thread's buffer and marks it finished when the thread exits
+    struct ThreadBufferHandle {
+        std::shared_ptr<ThreadTraceBuffer> buffer;
+
+        ~ThreadBufferHandle() {
+            if (!buffer) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(registryMutex);
+            buffer->finished = true;
+            // Nothing to export, so there is no need to wait for writeChromeTrace()
+            if (buffer->count.load(std::memory_order_relaxed) == 0) {
+                recycleFinishedBuffers();
+            }
+        }
+    };
+
+    ThreadTraceBuffer &threadBuffer() {
+        thread_local ThreadBufferHandle handle;
+        if (!handle.buffer) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            if (!freeBuffers.empty() && freeBuffers.back()->capacity == bufferCapacity.load()) {
+                handle.buffer = std::move(freeBuffers.back());
+                freeBuffers.pop_back();
+                handle.buffer->threadId = nextThreadId++;
+            } else {
+                freeBuffers.clear();
+                handle.buffer = std::make_shared<ThreadTraceBuffer>(nextThreadId++, bufferCapacity.load());
+            }
+            registry.push_back(handle.buffer);
+        }
+        return *handle.buffer;
+    }
+
+    int64_t nowNanoseconds() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(MonotonicClock::now().time_since_epoch()).count();
+    }
+
+    void writeMicroseconds(std::ostream &output, int64_t nanoseconds) {
+        output << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0') << nanoseconds % 1000
+               << std::setfill(' ');
+    }
+
+    void writeJsonString(std::ostream &output, const char *text) {
+        output << '"';
+        for (; *text != '\0'; text++) {
+            if (*text == '"' || *text == '\\') {
+                output << '\\';
+            }
+            output << *text;
+        }
+        output << '"';
+    }
+}
+
+TraceSpan::TraceSpan(const char *name) : name(name), start(nowNanoseconds()) {}
+
+TraceSpan::~TraceSpan() {
+    int64_t end = nowNanoseconds();
+    ThreadTraceBuffer &buffer = threadBuffer();
+    std::size_t index = buffer.count.load(std::memory_order_relaxed);
+    if (index == buffer.capacity) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[index] = TraceEvent{name, start, end - start};
+    buffer.count.store(index + 1, std::memory_order_release);
+}
+
+void writeChromeTrace(std::ostream &output) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    output << "{\"traceEvents\":[";
+    bool first = true;
+    for (const auto &buffer: registry) {
+        std::size_t count = buffer->count.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < count; i++) {
+            const TraceEvent &event = buffer->events[i];
+            output << (first ? "\n" : ",\n") << "{\"name\":";
+            writeJsonString(output, event.name);
+            output << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"ts\":";
+            writeMicroseconds(output, event.start);
+            output << ",\"dur\":";
+            writeMicroseconds(output, event.duration);
+            output << '}';
+            first = false;
+        }
+    }
+    output << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    recycleFinishedBuffers();
+}
+
+void setTraceBufferCapacity(std::size_t capacity) {
+    bufferCapacity.store(capacity);
+}
+
+long getDroppedTraceSpans() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    long dropped = droppedByRecycledBuffers;
+    for (const auto &buffer: registry) {
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+void clearTrace() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto &buffer: registry) {
+        buffer->count.store(0, std::memory_order_release);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+    }
+    recycleFinishedBuffers();
+    droppedByRecycledBuffers = 0;
+}
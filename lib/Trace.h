@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Timing.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/*
+ * Opt-in tracing. Build with -DTRACING=ON to record a timestamped span for every TRACE_SPAN in scope; without it the
+ * macro expands to nothing. Spans are stored in a fixed-size buffer per thread (no locks or allocation after a thread's
+ * first span) and can be written out with writeChromeTrace(), then loaded into chrome://tracing or ui.perfetto.dev.
+ * Once a thread has finished and its spans have been written out (or cleared), its buffer is reused by the next new
+ * thread, so short-lived threads do not each keep a buffer.
+ */
+
+/// @brief Default number of spans each thread can record before further spans are dropped
+const std::size_t TRACE_BUFFER_CAPACITY = 1 << 16;
+
+/// @brief Records the time from its construction to its destruction as a span on the calling thread
+class TraceSpan {
+private:
+    const char *name;
+    int64_t start;
+
+public:
+    /// @param name what the span measures. Must be a string literal (or otherwise outlive the trace).
+    explicit TraceSpan(const char *name);
+
+    TraceSpan(const TraceSpan &) = delete;
+
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+    ~TraceSpan();
+};
+
+/// @brief Set how many spans each thread can record. Only affects threads that record their first span after the call.
+/// @param capacity the number of spans per thread (each takes 24 bytes)
+void setTraceBufferCapacity(std::size_t capacity);
+
+/// @brief Write every span recorded so far, by any thread, as Chrome trace event JSON. The spans of threads that have
+/// finished are only written once; their buffers are then handed to new threads.
+/// @param output where to write the JSON
+void writeChromeTrace(std::ostream &output);
+
+/// @brief Number of spans that were dropped because a thread's buffer was full
+long getDroppedTraceSpans();
+
+/// @brief Forget every recorded span. Must not be called while other threads are recording spans.
+void clearTrace();
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef TRACING
+/// @brief Record a span from here to the end of the enclosing scope
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+#else
+#define TRACE_SPAN(name) do {} while (0)
+#endif
@@ -0,0 +1,181 @@
+#include "Traffic_Capture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+TrafficCapture::TrafficCapture(std::ostream &sink, std::size_t capacity, std::chrono::milliseconds flushInterval)
+        : sink(sink), flushInterval(flushInterval), outgoing(capacity), incoming(capacity) {
+    TrafficCaptureHeader header{
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count(),
+            std::chrono::duration_cast<std::chrono::nanoseconds>(MonotonicClock::now().time_since_epoch()).count()};
+    sink.write(TRAFFIC_CAPTURE_MAGIC, sizeof(TRAFFIC_CAPTURE_MAGIC));
+    sink.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    writerThread = std::thread(&TrafficCapture::run, this);
+}
+
+void TrafficCapture::record(TrafficDirection direction, const char *data, std::size_t length) {
+    Direction &queue = direction == OutgoingTraffic ? outgoing : incoming;
+    std::size_t chunksNeeded = std::max<std::size_t>(1, (length + TRAFFIC_CHUNK_SIZE - 1) / TRAFFIC_CHUNK_SIZE);
+    if (queue.chunks.capacity() - queue.chunks.size() < chunksNeeded) {
+        queue.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            MonotonicClock::now().time_since_epoch()).count();
+    for (std::size_t i = 0; i < chunksNeeded; i++) {
+        Chunk *chunk = queue.chunks.reserve(i);
+        std::size_t chunkLength = std::min(length, TRAFFIC_CHUNK_SIZE);
+        chunk->header = TrafficRecordHeader{timestamp, direction,
+                                            (uint8_t) (length > chunkLength ? TrafficContinues : 0),
+                                            (uint16_t) chunkLength, 0};
+        std::memcpy(chunk->data, data, chunkLength);
+        data += chunkLength;
+        length -= chunkLength;
+    }
+    // Publish the whole frame at once, so the writer never sees a frame whose continuation is still being filled in
+    queue.chunks.publish(chunksNeeded);
+    queue.recorded.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TrafficCapture::run() {
+    while (running.load()) {
+        drain();
+        std::this_thread::sleep_for(flushInterval);
+    }
+    drain();
+}
+
+void TrafficCapture::writeFrame(Direction &direction) {
+    Chunk *chunk;
+    while ((chunk = direction.chunks.front()) != nullptr) {
+        bool continues = chunk->header.flags & TrafficContinues;
+        sink.write(reinterpret_cast<const char *>(&chunk->header), sizeof(TrafficRecordHeader));
+        sink.write(chunk->data, chunk->header.length);
+        direction.chunks.release();
+        if (!continues) {
+            break;
+        }
+    }
+}
+
+void TrafficCapture::drain() {
+    long count = 0;
+    while (true) {
+        Chunk *nextOutgoing = outgoing.chunks.front();
+        Chunk *nextIncoming = incoming.chunks.front();
+        if (nextOutgoing == nullptr && nextIncoming == nullptr) {
+            break;
+        }
+        // Merge the two directions by time, so the file reads in the order things happened
+        if (nextIncoming == nullptr ||
+            (nextOutgoing != nullptr && nextOutgoing->header.timestamp <= nextIncoming->header.timestamp)) {
+            writeFrame(outgoing);
+        } else {
+            writeFrame(incoming);
+        }
+        count++;
+    }
+    if (count > 0) {
+        sink.flush();
+        written.fetch_add(count, std::memory_order_release);
+    }
+}
+
+void TrafficCapture::flush() {
+    // Frames are only counted once all of their chunks are written, so this cannot return part-way through a frame
+    while (written.load(std::memory_order_acquire) < outgoing.recorded.load() + incoming.recorded.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+long TrafficCapture::getRecordedCount(TrafficDirection direction) const {
+    return (direction == OutgoingTraffic ? outgoing : incoming).recorded.load(std::memory_order_relaxed);
+}
+
+long TrafficCapture::getDroppedCount(TrafficDirection direction) const {
+    return (direction == OutgoingTraffic ? outgoing : incoming).dropped.load(std::memory_order_relaxed);
+}
+
+TrafficCapture::~TrafficCapture() {
+    running.store(false);
+    writerThread.join();
+}
+
+TrafficCaptureReader::TrafficCaptureReader(std::istream &input) : input(input) {
+    char magic[sizeof(TRAFFIC_CAPTURE_MAGIC)];
+    valid = input.read(magic, sizeof(magic)) &&
+            std::memcmp(magic, TRAFFIC_CAPTURE_MAGIC, sizeof(magic)) == 0 &&
+            input.read(reinterpret_cast<char *>(&captureHeader), sizeof(captureHeader));
+}
+
+bool TrafficCaptureReader::next(TrafficFrame &frame) {
+    if (!valid) {
+        return false;
+    }
+    frame.data.clear();
+    TrafficRecordHeader record{};
+    char data[TRAFFIC_CHUNK_SIZE];
+    do {
+        if (!input.read(reinterpret_cast<char *>(&record), sizeof(record)) || record.length > TRAFFIC_CHUNK_SIZE ||
+            !input.read(data, record.length)) {
+            return false;
+        }
+        if (frame.data.empty()) {
+            frame.timestamp = record.timestamp;
+            frame.direction = (TrafficDirection) record.direction;
+        }
+        frame.data.append(data, record.length);
+    } while (record.flags & TrafficContinues);
+    return true;
+}
+
+std::string formatTrafficFrame(const TrafficFrame &frame, const TrafficCaptureHeader &header) {
+    int64_t wallClock = header.wallClockStart + (frame.timestamp - header.monotonicStart);
+    std::time_t seconds = (std::time_t) (wallClock / 1000000000);
+    std::tm time{};
+    localtime_r(&seconds, &time);
+
+    std::ostringstream line;
+    line << std::put_time(&time, "%Y-%m-%d %H:%M:%S") << '.' << std::setw(9) << std::setfill('0')
+         << wallClock % 1000000000 << ' ' << (frame.direction == OutgoingTraffic ? "->" : "<-") << ' '
+         << std::setw(0) << std::setfill(' ') << frame.data.size() << " bytes: ";
+    for (char character: frame.data) {
+        if (character >= 0x20 && character < 0x7F && character != '\\') {
+            line << character;
+        } else if (character == '\n') {
+            line << "\\n";
+        } else {
+            line << "\\x" << std::hex << std::setw(2) << std::setfill('0') << (int) (uint8_t) character << std::dec;
+        }
+    }
+    return line.str();
+}
+
+long replayTraffic(TrafficCaptureReader &reader, const std::function<void(const TrafficFrame &)> &send,
+                   bool realTime) {
+    HybridWaitStrategy waitStrategy;
+    CancellationToken cancellation;
+    TrafficFrame frame;
+    long replayed = 0;
+    int64_t firstTimestamp = 0;
+    MonotonicClock::time_point start;
+    while (reader.next(frame)) {
+        if (frame.direction != OutgoingTraffic) {
+            continue;
+        }
+        if (replayed == 0) {
+            firstTimestamp = frame.timestamp;
+            start = MonotonicClock::now();
+        } else if (realTime) {
+            // Deadlines are relative to the first frame, so waiting errors never add up
+            waitStrategy.wait(start + std::chrono::nanoseconds(frame.timestamp - firstTimestamp), cancellation);
+        }
+        send(frame);
+        replayed++;
+    }
+    return replayed;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "Ring_Buffer.h"
+#include "Timing.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <thread>
+
+/*
+ * Traffic capture format (native byte order, little endian on the Pi):
+ *
+ *     header: "PROPCAP1" | int64 wall clock ns at start | int64 monotonic ns at start
+ *     records: TrafficRecordHeader (16 bytes) followed by `length` bytes of data
+ *
+ * Each record holds up to TRAFFIC_CHUNK_SIZE bytes. A longer frame is split over consecutive records of the same
+ * direction; every record but the last has the TrafficContinues flag set. Outgoing records are whole frames as
+ * written to the serial port; incoming records are whatever a single read() returned.
+ */
+
+/// @brief Magic bytes at the start of every traffic capture
+const char TRAFFIC_CAPTURE_MAGIC[8] = {'P', 'R', 'O', 'P', 'C', 'A', 'P', '1'};
+
+/// @brief Largest number of data bytes in one record
+const std::size_t TRAFFIC_CHUNK_SIZE = 256;
+
+/// @brief Which way a frame went over the serial link
+enum TrafficDirection : uint8_t {
+    OutgoingTraffic = 'O', IncomingTraffic = 'I'
+};
+
+/// @brief Set on every record of a split frame except the last
+const uint8_t TrafficContinues = 1;
+
+/// @brief The fixed-size part of a capture record
+struct TrafficRecordHeader {
+    /// @brief Monotonic clock time the frame was written or read, in nanoseconds
+    int64_t timestamp;
+    uint8_t direction;
+    uint8_t flags;
+    uint16_t length;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(TrafficRecordHeader) == 16, "Capture records must keep 16-byte headers: the format depends on it");
+
+/// @brief The start of a traffic capture
+struct TrafficCaptureHeader {
+    int64_t wallClockStart;
+    int64_t monotonicStart;
+};
+
+/// @brief Records every frame sent to and received from the Pico in a binary capture file, without blocking the
+/// threads that send and receive. record() only copies the frame into a lock-free queue (one queue per direction);
+/// a background thread writes the queued records to the sink. At a time, only one thread may record outgoing frames
+/// and only one thread may record incoming frames.
+class TrafficCapture {
+private:
+    struct Chunk {
+        TrafficRecordHeader header;
+        char data[TRAFFIC_CHUNK_SIZE];
+    };
+
+    struct Direction {
+        RingBuffer<Chunk> chunks;
+        // Written by the recording thread
+        std::atomic<long> recorded{0};
+        std::atomic<long> dropped{0};
+
+        explicit Direction(std::size_t capacity) : chunks(capacity) {}
+    };
+
+    std::ostream &sink;
+    std::chrono::milliseconds flushInterval;
+    Direction outgoing;
+    Direction incoming;
+    std::thread writerThread;
+    std::atomic<bool> running{true};
+    // Written by the writer thread
+    std::atomic<long> written{0};
+
+    void run();
+
+    /// @brief Write every queued record to the sink, oldest first
+    void drain();
+
+    /// @brief Write one whole frame (all of its chunks) from the queue
+    void writeFrame(Direction &direction);
+
+public:
+    /// @param sink where the capture is written, e.g. a std::ofstream opened with std::ios::binary
+    /// @param capacity how many chunks each direction can queue before new frames are dropped
+    /// @param flushInterval how often the writer thread writes out queued records
+    explicit TrafficCapture(std::ostream &sink, std::size_t capacity = 1024,
+                            std::chrono::milliseconds flushInterval = std::chrono::milliseconds(10));
+
+    TrafficCapture(const TrafficCapture &) = delete;
+
+    TrafficCapture &operator=(const TrafficCapture &) = delete;
+
+    /// @brief Record a frame. Never blocks or allocates; if the queue does not have room for the whole frame, the
+    /// frame is dropped and counted.
+    /// @param direction which way the frame went
+    /// @param data the bytes of the frame
+    /// @param length the number of bytes
+    void record(TrafficDirection direction, const char *data, std::size_t length);
+
+    /// @brief Wait until every frame recorded so far has been written to the sink. Call from a recording thread.
+    void flush();
+
+    /// @brief Number of frames recorded in the given direction (not counting dropped frames)
+    long getRecordedCount(TrafficDirection direction) const;
+
+    /// @brief Number of frames dropped in the given direction because the queue was full
+    long getDroppedCount(TrafficDirection direction) const;
+
+    /// @brief Writes everything still queued, then stops the writer thread
+    ~TrafficCapture();
+};
+
+/// @brief One frame read back from a capture
+struct TrafficFrame {
+    int64_t timestamp;
+    TrafficDirection direction;
+    std::string data;
+};
+
+/// @brief Reads the frames of a traffic capture, joining split frames back together
+class TrafficCaptureReader {
+private:
+    std::istream &input;
+    TrafficCaptureHeader captureHeader{};
+    bool valid;
+
+public:
+    /// @param input the capture, opened in binary mode and positioned at its start
+    explicit TrafficCaptureReader(std::istream &input);
+
+    /// @brief Whether the input starts with a traffic capture header
+    bool isValid() const { return valid; }
+
+    const TrafficCaptureHeader &header() const { return captureHeader; }
+
+    /// @brief Read the next frame
+    /// @param frame where to store the frame
+    /// @return False at the end of the capture (or if it is cut off in the middle of a record)
+    bool next(TrafficFrame &frame);
+};
+
+/// @brief Turn a captured frame into one line of text (without a trailing newline). Printable ASCII is shown as is,
+/// anything else as \xNN escapes.
+std::string formatTrafficFrame(const TrafficFrame &frame, const TrafficCaptureHeader &header);
+
+/// @brief Send the outgoing frames of a capture again
+/// @param reader the capture to replay
+/// @param send called with each outgoing frame
+/// @param realTime whether to keep the original spacing between frames, or send them as fast as possible
+/// @return The number of frames replayed
+long replayTraffic(TrafficCaptureReader &reader, const std::function<void(const TrafficFrame &)> &send,
+                   bool realTime);
@@ -0,0 +1,69 @@
+#include "Wire_Protocol.h"
+
+uint8_t crc8(const uint8_t *data, std::size_t length) {
+    uint8_t crc = 0;
+    for (std::size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ 0x07) : (uint8_t) (crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint16_t encodeBinaryRecord(int pinNumber, int value) {
+    return (uint16_t) (((pinNumber & 0x1F) << 11) | (value & BINARY_RECORD_MAX_VALUE));
+}
+
+int binaryRecordPin(uint16_t record) {
+    return record >> 11;
+}
+
+int binaryRecordValue(uint16_t record) {
+    return record & 0x7FF;
+}
+
+std::size_t binaryFrameSize(int recordCount) {
+    return BINARY_FRAME_HEADER_SIZE + recordCount * BINARY_RECORD_SIZE + 1;
+}
+
+/// @brief The two digits of every number from 00 to 99, so numbers are formatted two digits per division
+static const char DIGIT_PAIRS[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+std::size_t formatDecimal(char *buffer, int value) {
+    std::size_t length = 0;
+    auto magnitude = (unsigned int) value;
+    if (value < 0) {
+        buffer[length++] = '-';
+        magnitude = 0u - magnitude;
+    }
+    std::size_t digits = 1;
+    for (unsigned int rest = magnitude; rest >= 10; rest /= 10) {
+        digits++;
+    }
+    length += digits;
+    char *end = buffer + length;
+    while (magnitude >= 100) {
+        unsigned int pair = (magnitude % 100) * 2;
+        magnitude /= 100;
+        *--end = DIGIT_PAIRS[pair + 1];
+        *--end = DIGIT_PAIRS[pair];
+    }
+    if (magnitude >= 10) {
+        *--end = DIGIT_PAIRS[magnitude * 2 + 1];
+        *--end = DIGIT_PAIRS[magnitude * 2];
+    } else {
+        *--end = (char) ('0' + magnitude);
+    }
+    return length;
+}
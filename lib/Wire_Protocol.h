@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * Binary wire protocol
+ *
+ * A binary frame carries any number of updates of the same kind:
+ *
+ *   [0xA5 sync] [frame type] [sequence number] [record count] [records...] [CRC-8]
+ *
+ * Each record is two bytes, big-endian: the top 5 bits are the GPIO number (0-29 on the Pico) and the bottom 11 bits
+ * are the value (a pulse width for PWM frames, 0/1 for digital frames, a PinType for configure frames). The CRC-8
+ * (polynomial 0x07, initial value 0) covers everything after the sync byte. A full 8-thruster update is 21 bytes.
+ *
+ * With acknowledgements enabled, every write ends with a sequence marker: a sequence frame with no records (5 bytes) in
+ * binary mode, or the line "Seq <n>" in ASCII mode. The Pico answers each marker with the line "Ack <n>".
+ */
+
+/// @brief First byte of every binary frame
+const uint8_t BINARY_FRAME_SYNC = 0xA5;
+
+/// @brief Number of bytes in a binary frame before the first record (sync, type, sequence number, count)
+const std::size_t BINARY_FRAME_HEADER_SIZE = 4;
+
+/// @brief Number of bytes in a single binary record
+const std::size_t BINARY_RECORD_SIZE = 2;
+
+/// @brief Largest value a binary record can hold (11 bits)
+const int BINARY_RECORD_MAX_VALUE = 0x7FF;
+
+/// @brief Maximum number of records that fit in one binary frame
+const int BINARY_FRAME_MAX_RECORDS = 255;
+
+/// @brief What the records of a binary frame describe
+enum BinaryFrameType : uint8_t {
+    ConfigureFrame = 'C', DigitalFrame = 'D', PwmFrame = 'P', ProtocolFrame = 'M', SequenceFrame = 'S'
+};
+
+/// @brief CRC-8 (polynomial 0x07) of a block of bytes
+/// @param data the bytes to checksum
+/// @param length the number of bytes
+/// @return The checksum
+uint8_t crc8(const uint8_t *data, std::size_t length);
+
+/// @brief Pack a pin number and value into a binary record
+/// @param pinNumber a GPIO number between 0 and 31
+/// @param value a value between 0 and BINARY_RECORD_MAX_VALUE. Other values wrap, so callers must check the range.
+/// @return The two-byte record, in host order
+uint16_t encodeBinaryRecord(int pinNumber, int value);
+
+/// @brief The GPIO number stored in a binary record
+int binaryRecordPin(uint16_t record);
+
+/// @brief The value stored in a binary record
+int binaryRecordValue(uint16_t record);
+
+/// @brief Total size of a binary frame holding the given number of records
+std::size_t binaryFrameSize(int recordCount);
+
+/// @brief Most characters formatDecimal() writes (a sign and ten digits)
+const std::size_t DECIMAL_MAX_SIZE = 11;
+
+/// @brief Write an integer in decimal, exactly as std::to_string would, without allocating
+/// @param buffer where to write the digits (at least DECIMAL_MAX_SIZE characters, not null-terminated)
+/// @param value the number to write
+/// @return The number of characters written
+std::size_t formatDecimal(char *buffer, int value);
+
+/// @brief Longest ASCII message an AsciiMessage can hold
+const std::size_t ASCII_MESSAGE_MAX_SIZE = 48;
+
+/// @brief Builds one ASCII protocol message (e.g. "Set 4 PWM 1500\n") in a fixed buffer on the stack, so encoding a
+/// message never allocates or measures strings at run time. Text that would not fit is dropped.
+class AsciiMessage {
+private:
+    char buffer[ASCII_MESSAGE_MAX_SIZE];
+    std::size_t length = 0;
+
+public:
+    /// @brief Append a string literal; its length is known at compile time
+    template<std::size_t N>
+    AsciiMessage &text(const char (&literal)[N]) {
+        if (length + N - 1 <= ASCII_MESSAGE_MAX_SIZE) {
+            std::memcpy(buffer + length, literal, N - 1);
+            length += N - 1;
+        }
+        return *this;
+    }
+
+    /// @brief Append an integer in decimal
+    AsciiMessage &number(int value) {
+        if (length + DECIMAL_MAX_SIZE <= ASCII_MESSAGE_MAX_SIZE) {
+            length += formatDecimal(buffer + length, value);
+        }
+        return *this;
+    }
+
+    const char *data() const { return buffer; }
+
+    std::size_t size() const { return length; }
+};
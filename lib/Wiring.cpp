@@ -1,9 +1,12 @@
 // William Barber
 
 #include "Wiring.h"
+#include "Trace.h"
 
 #include <iostream>
+#include <cstring>
 #include <string>
+#include <utility>
 
 // When compiling for non-RPI devices which cannot run wiringPi library,
 // use -MOCK_RPI flag to enable mock functions
@@ -13,9 +16,27 @@ bool WiringControl::initializeSerial() {
     return true;
 }
 
+bool WiringControl::initializeSerial(const SerialConfig &config) {
+    // Like a real connection, only the first call takes effect
+    if (linkBudget->getBaud() == 0) {
+        linkBudget->setBaud(config.baud);
+    }
+    return true;
+}
+
+
+void WiringControl::writeToSerial(const char *data, std::size_t length) {
+    TRACE_SPAN("WiringControl::writeToSerial");
+    if (trafficCapture) {
+        trafficCapture->record(OutgoingTraffic, data, length);
+    }
+    linkBudget->record(length);
+    output.write(data, (std::streamsize) length);
+}
 
-void WiringControl::printToSerial(const std::string& message) {
-    output << message;
+bool WiringControl::enableAsyncOutput(std::size_t) {
+    // There is no serial port to write to
+    return false;
 }
 
 #else
@@ -23,115 +44,274 @@ void WiringControl::printToSerial(const std::string& message) {
 #include "Serial.h"
 
 bool WiringControl::initializeSerial() {
-    if ((serial = serialOpen("/dev/serial/by-id/usb-MicroPython_Board_in_FS_mode_e66130100f198434-if00", 115200)) < 0) {
+    return initializeSerial(SerialConfig{});
+}
+
+bool WiringControl::initializeSerial(const SerialConfig &config) {
+    if (serialConnection) {
+        return true;
+    }
+    auto connection = std::make_shared<SerialConnection>(config, errorLog);
+    if (!connection->open()) {
         return false;
     }
+    serialConnection = connection;
+    serial = connection->getFd();
+    linkBudget->setBaud(config.baud);
     return true;
 }
 
-void WiringControl::printToSerial(const std::string &message) {
+void WiringControl::writeToSerial(const char *data, std::size_t length) {
+    TRACE_SPAN("WiringControl::writeToSerial");
+    if (trafficCapture) {
+        trafficCapture->record(OutgoingTraffic, data, length);
+    }
+    if (serial != -1 && !serialConnection->isConnected()) {
+        // The cached pin state is sent again once the connection is back
+        serialConnection->countDroppedWrite();
+        return;
+    }
+    linkBudget->record(length);
     if (serial == -1) {
-        output << message;
-    } else {
-        serialPuts(serial, message.c_str());
+        output.write(data, (std::streamsize) length);
+    } else if (serialWriter) {
+        if (!serialWriter->enqueue(data, length)) {
+            // The cached pin state already holds the dropped frame's values, so send every pin again with the next
+            // frame (in change-only mode they would otherwise never be sent)
+            keyframePending = true;
+        }
+    } else if (!serialWrite(serial, data, length)) {
+        serialConnection->markLost();
     }
 }
 
+bool WiringControl::enableAsyncOutput(std::size_t capacity) {
+    if (serial == -1) {
+        return false;
+    }
+    // A failed write means the device is gone, exactly as in the synchronous path
+    std::shared_ptr<SerialConnection> connection = serialConnection;
+    serialWriter = std::make_shared<SerialWriter>(serial, capacity, errorLog, [connection]() {
+        connection->markLost();
+    });
+    return true;
+}
+
 #endif
 
-WiringControl::WiringControl(std::ostream &output, std::ostream &outLog, std::ostream &errorLog) : output(output),
-                                                                                                      outLog(outLog),
-                                                                                                      errorLog(
-                                                                                                              errorLog) {};
+bool WiringControl::initializeSerial(const std::string &device, int baud) {
+    SerialConfig config;
+    config.devices = {device};
+    config.baud = baud;
+    return initializeSerial(config);
+}
+
+WiringControl::WiringControl(std::ostream &output, std::ostream &outLog, std::ostream &errorLog)
+        : ackWindow(std::make_shared<AckWindow>()), linkBudget(std::make_shared<LinkBudget>()), output(output),
+          outLog(outLog), errorLog(errorLog) {};
+
+void WiringControl::printToSerial(const char *message, std::size_t length) {
+    beginAsciiMessage();
+    pendingFrame.append(message, length);
+    endFrame();
+}
 
 void WiringControl::setPinType(int pinNumber, PinType pinType) {
-    std::string message = "Configure ";
-    message.append(std::to_string(pinNumber));
+    if (pinNumber >= PICO_GPIO_COUNT) {
+        WiringControl &link = linkFor(pinNumber);
+        link.setPinType(pinNumber, pinType);
+        return;
+    }
+    checkPinNumber(pinNumber);
+    // The Pico resets a pin when it is configured, so its cached status no longer describes it
+    if (pinType == HardwarePWM || pinType == SoftwarePWM) {
+        pinStates.pwmStatusKnown[pinNumber] = false;
+    } else {
+        pinStates.digitalStatusKnown[pinNumber] = false;
+    }
+    if (eventLog) {
+        eventLog->record(ConfigureEvent, pinNumber, pinType);
+    }
+    beginFrame();
     switch (pinType) {
         case DigitalActiveHigh:
-            message.append(" Digital\n");
-            printToSerial(message);
-            pinTypes[pinNumber] = DigitalActiveHigh;
+            sendConfigure(pinNumber, pinType);
+            pinStates.types[pinNumber] = DigitalActiveHigh;
             digitalWrite(pinNumber, Low);
-            digitalPinStatuses[pinNumber] = Low;
             break;
         case DigitalActiveLow:
-            message.append(" Digital\n");
-            printToSerial(message);
-            pinTypes[pinNumber] = DigitalActiveLow;
+            sendConfigure(pinNumber, pinType);
+            pinStates.types[pinNumber] = DigitalActiveLow;
             digitalWrite(pinNumber, High);
-            digitalPinStatuses[pinNumber] = High;
             break;
         case HardwarePWM:
-            message.append(" HardPwm\n");
-            printToSerial(message);
-            pinTypes[pinNumber] = HardwarePWM;
+            sendConfigure(pinNumber, pinType);
+            pinStates.types[pinNumber] = HardwarePWM;
             pwmWrite(pinNumber, 1500);
-            pwmPinStatuses[pinNumber] = PwmPinStatus{1500, 0};
+            pinStates.pwmStatuses[pinNumber] = PwmPinStatus{1500, 0};
             break;
         case SoftwarePWM:
-            message.append(" SoftPwm\n");
-            printToSerial(message);
-            pinTypes[pinNumber] = SoftwarePWM;
+            sendConfigure(pinNumber, pinType);
+            pinStates.types[pinNumber] = SoftwarePWM;
             pwmWrite(pinNumber, 1500);
-            pwmPinStatuses[pinNumber] = PwmPinStatus{1500, 0};
+            pinStates.pwmStatuses[pinNumber] = PwmPinStatus{1500, 0};
             break;
         default:
             errorLog << "Impossible pin type " << pinType << "! Exiting." << std::endl;
             exit(42);
     }
-    pinTypes[pinNumber] = pinType;
+    endFrame();
 }
 
 void WiringControl::digitalWrite(int pinNumber, DigitalPinStatus digitalPinStatus) {
-    std::string message = "Set ";
-    message.append(std::to_string(pinNumber));
+    if (pinNumber >= PICO_GPIO_COUNT) {
+        WiringControl &link = linkFor(pinNumber);
+        link.digitalWrite(pinNumber, digitalPinStatus);
+        return;
+    }
+    checkPinNumber(pinNumber);
+    bool changed = !pinStates.digitalStatusKnown[pinNumber] ||
+                   pinStates.digitalStatuses[pinNumber] != digitalPinStatus;
+    beginFrame();
     switch (digitalPinStatus) {
         case Low:
-            message.append(" Digital Low\n");
-            printToSerial(message);
-            digitalPinStatuses[pinNumber] = Low;
-            break;
         case High:
-            message.append(" Digital High\n");
-            printToSerial(message);
-            digitalPinStatuses[pinNumber] = High;
+            if (shouldSend(changed)) {
+                sendDigital(pinNumber, digitalPinStatus);
+            }
+            pinStates.digitalStatuses[pinNumber] = digitalPinStatus;
+            pinStates.digitalStatusKnown[pinNumber] = true;
+            if (eventLog) {
+                eventLog->record(DigitalWriteEvent, pinNumber, digitalPinStatus);
+            }
             break;
         default:
             errorLog << "Impossible digital pin status " << digitalPinStatus << "! Exiting." << std::endl;
             exit(42);
     }
-    digitalPinStatuses[pinNumber] = digitalPinStatus;
+    endFrame();
 }
 
 DigitalPinStatus WiringControl::digitalRead(int pinNumber) {
-    return digitalPinStatuses[pinNumber];
+    if (pinNumber >= PICO_GPIO_COUNT) {
+        WiringControl &link = linkFor(pinNumber);
+        return link.digitalRead(pinNumber);
+    }
+    checkPinNumber(pinNumber);
+    return pinStates.digitalStatuses[pinNumber];
 }
 
 void WiringControl::pwmWrite(int pinNumber, int pulseWidth) {
-    std::string message = "Set ";
-    message.append(std::to_string(pinNumber));
-    switch (pinTypes[pinNumber]) {
+    TRACE_SPAN("WiringControl::pwmWrite");
+    if (pinNumber >= PICO_GPIO_COUNT) {
+        WiringControl &link = linkFor(pinNumber);
+        link.pwmWrite(pinNumber, pulseWidth);
+        return;
+    }
+    checkPinNumber(pinNumber);
+    bool changed = !pinStates.pwmStatusKnown[pinNumber] || pinStates.pwmStatuses[pinNumber].pulseWidth != pulseWidth;
+    switch (pinStates.types[pinNumber]) {
         case HardwarePWM:
         case SoftwarePWM:
-            message.append(" PWM ");
-            message.append(std::to_string(pulseWidth));
-            message.append("\n");
-            printToSerial(message);
-            pwmPinStatuses[pinNumber].pulseWidth = pulseWidth;
+            beginFrame();
+            if (shouldSend(changed)) {
+                sendPwm(pinNumber, pulseWidth);
+            }
+            pinStates.pwmStatuses[pinNumber].pulseWidth = pulseWidth;
+            pinStates.pwmStatusKnown[pinNumber] = true;
+            if (eventLog) {
+                eventLog->record(PwmWriteEvent, pinNumber, pulseWidth);
+            }
+            endFrame();
             break;
         case DigitalActiveHigh:
         case DigitalActiveLow:
             errorLog << "Invalid pin type \"Digital\". Digital pin type cannot be used for PWM. Exiting." << std::endl;
             exit(42);
+        case Unconfigured:
+            errorLog << "Pin " << pinNumber << " has not been configured for PWM! Exiting." << std::endl;
+            exit(42);
         default:
-            errorLog << "Impossible pin type " << pinTypes[pinNumber] << "! Exiting." << std::endl;
+            errorLog << "Impossible pin type " << pinStates.types[pinNumber] << "! Exiting." << std::endl;
             exit(42);
     }
 }
 
 PwmPinStatus WiringControl::pwmRead(int pinNumber) {
-    return pwmPinStatuses[pinNumber];
+    if (pinNumber >= PICO_GPIO_COUNT) {
+        WiringControl &link = linkFor(pinNumber);
+        return link.pwmRead(pinNumber);
+    }
+    checkPinNumber(pinNumber);
+    return pinStates.pwmStatuses[pinNumber];
+}
+
+PinStateTable WiringControl::getPinStates() const {
+    return pinStates;
+}
+
+WiringControl &WiringControl::linkFor(int &pinNumber) {
+    int link = pinNumber / PICO_GPIO_COUNT;
+    if (link > (int) links.size()) {
+        errorLog << "Invalid pin number " << pinNumber << ", there are only pins 0-"
+                 << PICO_GPIO_COUNT * (links.size() + 1) - 1 << " on " << links.size() + 1 << " links! Exiting."
+                 << std::endl;
+        exit(42);
+    }
+    pinNumber %= PICO_GPIO_COUNT;
+    return *links[link - 1];
+}
+
+int WiringControl::addLink(std::shared_ptr<WiringControl> link) {
+    if (frameDepth != 0) {
+        errorLog << "Links cannot be added inside a frame!" << std::endl;
+        return -1;
+    }
+    if ((int) links.size() + 1 >= MAX_SERIAL_LINKS) {
+        errorLog << "Too many serial links, at most " << MAX_SERIAL_LINKS << " are supported!" << std::endl;
+        return -1;
+    }
+    link->setWireProtocol(wireProtocol);
+    link->setChangeOnly(changeOnly, keyframeInterval);
+    links.push_back(std::move(link));
+    return (int) links.size();
+}
+
+int WiringControl::addSerialLink(const SerialConfig &config) {
+    auto link = std::make_shared<WiringControl>(output, outLog, errorLog);
+    if (!link->initializeSerial(config)) {
+        errorLog << "Unable to open serial link " << links.size() + 1 << "!" << std::endl;
+        return -1;
+    }
+    // Every link writes on its own thread, so a frame reaches all of them in the time of the slowest link
+    if (!serialWriter) {
+        enableAsyncOutput();
+    }
+    link->enableAsyncOutput();
+    return addLink(link);
+}
+
+WiringControl &WiringControl::getLink(int link) {
+    if (link == 0) {
+        return *this;
+    }
+    if (link < 0 || link > (int) links.size()) {
+        errorLog << "There is no serial link " << link << "! Exiting." << std::endl;
+        exit(42);
+    }
+    return *links[link - 1];
+}
+
+int WiringControl::getLinkCount() const {
+    return (int) links.size() + 1;
+}
+
+void WiringControl::checkPinNumber(int pinNumber) {
+    if (pinNumber < 0 || pinNumber >= PICO_GPIO_COUNT) {
+        errorLog << "Invalid pin number " << pinNumber << ", the Pico only has GPIO 0-" << PICO_GPIO_COUNT - 1
+                 << "! Exiting." << std::endl;
+        exit(42);
+    }
 }
 
 void WiringControl::pwmWriteMaximum(int pinNumber) {
@@ -142,8 +322,474 @@ void WiringControl::pwmWriteOff(int pinNumber) {
     pwmWrite(pinNumber, 1500);
 }
 
+void WiringControl::setWireProtocol(WireProtocol protocol) {
+    for (auto &link: links) {
+        link->setWireProtocol(protocol);
+    }
+    if (protocol == wireProtocol) {
+        return;
+    }
+    if (protocol == BinaryProtocol) {
+        AsciiMessage message;
+        message.text("Protocol Binary\n");
+        printToSerial(message.data(), message.size());
+        wireProtocol = BinaryProtocol;
+    } else {
+        appendBinaryRecord(ProtocolFrame, 0, AsciiProtocol);
+        wireProtocol = AsciiProtocol;
+    }
+}
+
+WireProtocol WiringControl::getWireProtocol() const {
+    return wireProtocol;
+}
+
+void WiringControl::sendConfigure(int pinNumber, PinType pinType) {
+    if (wireProtocol == BinaryProtocol) {
+        appendBinaryRecord(ConfigureFrame, pinNumber, pinType);
+        return;
+    }
+    AsciiMessage message;
+    message.text("Configure ").number(pinNumber);
+    switch (pinType) {
+        case DigitalActiveHigh:
+        case DigitalActiveLow:
+            message.text(" Digital\n");
+            break;
+        case HardwarePWM:
+            message.text(" HardPwm\n");
+            break;
+        case SoftwarePWM:
+            message.text(" SoftPwm\n");
+            break;
+        default:
+            break;
+    }
+    beginAsciiMessage();
+    pendingFrame.append(message.data(), message.size());
+    endFrame();
+}
+
+void WiringControl::sendDigital(int pinNumber, DigitalPinStatus digitalPinStatus) {
+    if (wireProtocol == BinaryProtocol) {
+        appendBinaryRecord(DigitalFrame, pinNumber, digitalPinStatus);
+        return;
+    }
+    AsciiMessage message;
+    message.text("Set ").number(pinNumber);
+    if (digitalPinStatus == High) {
+        message.text(" Digital High\n");
+    } else {
+        message.text(" Digital Low\n");
+    }
+    beginAsciiMessage();
+    pendingFrame.append(message.data(), message.size());
+    endFrame();
+}
+
+void WiringControl::sendPwm(int pinNumber, int pulseWidth) {
+    TRACE_SPAN("WiringControl::sendPwm");
+    if (wireProtocol == BinaryProtocol) {
+        appendBinaryRecord(PwmFrame, pinNumber, pulseWidth);
+        return;
+    }
+    AsciiMessage message;
+    message.text("Set ").number(pinNumber).text(" PWM ").number(pulseWidth).text("\n");
+    beginAsciiMessage();
+    pendingFrame.append(message.data(), message.size());
+    endFrame();
+}
+
+void WiringControl::beginAsciiMessage() {
+    beginFrame();
+    if (binaryFrameOpen) {
+        closeBinaryFrame();
+    }
+}
+
+void WiringControl::appendBinaryRecord(BinaryFrameType frameType, int pinNumber, int value) {
+    beginFrame();
+    if (binaryFrameOpen && (binaryFrameType != frameType || binaryRecordCount == BINARY_FRAME_MAX_RECORDS)) {
+        closeBinaryFrame();
+    }
+    if (!binaryFrameOpen) {
+        binaryFrameStart = pendingFrame.size();
+        binaryFrameType = frameType;
+        binaryRecordCount = 0;
+        binaryFrameOpen = true;
+        pendingFrame.push_back((char) BINARY_FRAME_SYNC);
+        pendingFrame.push_back((char) frameType);
+        pendingFrame.push_back((char) sequenceNumber++);
+        pendingFrame.push_back(0);
+    }
+    if (value < 0 || value > BINARY_RECORD_MAX_VALUE) {
+        // The record only has 11 bits: wrapping would send a completely different value, so send the nearest one
+        int clamped = value < 0 ? 0 : BINARY_RECORD_MAX_VALUE;
+        errorLog << "Value " << value << " for pin " << pinNumber << " does not fit in a binary record, sending "
+                 << clamped << " instead!" << std::endl;
+        value = clamped;
+    }
+    uint16_t record = encodeBinaryRecord(pinNumber, value);
+    pendingFrame.push_back((char) (record >> 8));
+    pendingFrame.push_back((char) (record & 0xFF));
+    binaryRecordCount++;
+    endFrame();
+}
+
+void WiringControl::closeBinaryFrame() {
+    pendingFrame[binaryFrameStart + 3] = (char) binaryRecordCount;
+    auto frameBody = reinterpret_cast<const uint8_t *>(pendingFrame.data() + binaryFrameStart + 1);
+    pendingFrame.push_back((char) crc8(frameBody, pendingFrame.size() - binaryFrameStart - 1));
+    binaryFrameOpen = false;
+}
+
+void WiringControl::setChangeOnly(bool enabled, int interval) {
+    for (auto &link: links) {
+        link->setChangeOnly(enabled, interval);
+    }
+    changeOnly = enabled;
+    keyframeInterval = interval;
+    framesSinceKeyframe = 0;
+    keyframePending = false;
+}
+
+long WiringControl::getSuppressedWriteCount() const {
+    long suppressed = suppressedWrites;
+    for (const auto &link: links) {
+        suppressed += link->getSuppressedWriteCount();
+    }
+    return suppressed;
+}
+
+bool WiringControl::shouldSend(bool changed) {
+    if (!changeOnly) {
+        return true;
+    }
+    // Everything is sent by the keyframe refresh at the end of the frame
+    if (!keyframePending && changed) {
+        return true;
+    }
+    suppressedWrites++;
+    return false;
+}
+
+void WiringControl::restoreConnection() {
+    beginAsciiMessage();
+    if (ackWindow->isEnabled()) {
+        pendingFrame.append("echo off\nAck on\n");
+    }
+    if (wireProtocol == BinaryProtocol) {
+        pendingFrame.append("Protocol Binary\n");
+    }
+    endFrame();
+    for (int pinNumber = 0; pinNumber < PICO_GPIO_COUNT; pinNumber++) {
+        if (pinStates.types[pinNumber] != Unconfigured) {
+            sendConfigure(pinNumber, pinStates.types[pinNumber]);
+        }
+    }
+    refreshOwnPins();
+}
+
+void WiringControl::refreshPins() {
+    for (auto &link: links) {
+        link->refreshPins();
+    }
+    refreshOwnPins();
+}
+
+void WiringControl::refreshOwnPins() {
+    beginFrame();
+    for (int pinNumber = 0; pinNumber < PICO_GPIO_COUNT; pinNumber++) {
+        switch (pinStates.types[pinNumber]) {
+            case HardwarePWM:
+            case SoftwarePWM:
+                sendPwm(pinNumber, pinStates.pwmStatuses[pinNumber].pulseWidth);
+                break;
+            case DigitalActiveHigh:
+            case DigitalActiveLow:
+                sendDigital(pinNumber, pinStates.digitalStatuses[pinNumber]);
+                break;
+            default:
+                break;
+        }
+    }
+    endFrame();
+}
+
+void WiringControl::pwmWriteFrame(const int *pinNumbers, const int *pulseWidths, int count) {
+    beginFrame();
+    for (int i = 0; i < count; i++) {
+        pwmWrite(pinNumbers[i], pulseWidths[i]);
+    }
+    endFrame();
+}
+
+void WiringControl::pwmWriteEncoded(const char *frame, std::size_t length, const int *pinNumbers,
+                                    const int *pulseWidths, int count) {
+    TRACE_SPAN("WiringControl::pwmWriteEncoded");
+    // Check every pin before anything reaches the frame, so a bad pin never sends part of one
+    for (int i = 0; i < count; i++) {
+        checkPinNumber(pinNumbers[i]);
+    }
+    beginAsciiMessage();
+    std::size_t frameStart = pendingFrame.size();
+    pendingFrame.append(frame, length);
+    if (wireProtocol == BinaryProtocol) {
+        restampBinaryFrames(frameStart);
+    }
+    for (int i = 0; i < count; i++) {
+        pinStates.pwmStatuses[pinNumbers[i]].pulseWidth = pulseWidths[i];
+        pinStates.pwmStatusKnown[pinNumbers[i]] = true;
+        if (eventLog) {
+            eventLog->record(PwmWriteEvent, pinNumbers[i], pulseWidths[i]);
+        }
+    }
+    endFrame();
+}
+
+void WiringControl::restampBinaryFrames(std::size_t start) {
+    std::size_t frameStart = start;
+    while (frameStart + BINARY_FRAME_HEADER_SIZE <= pendingFrame.size() &&
+           (uint8_t) pendingFrame[frameStart] == BINARY_FRAME_SYNC) {
+        std::size_t frameSize = binaryFrameSize((uint8_t) pendingFrame[frameStart + 3]);
+        if (frameStart + frameSize > pendingFrame.size()) {
+            break;
+        }
+        pendingFrame[frameStart + 2] = (char) sequenceNumber++;
+        auto frameBody = reinterpret_cast<const uint8_t *>(pendingFrame.data() + frameStart + 1);
+        pendingFrame[frameStart + frameSize - 1] = (char) crc8(frameBody, frameSize - 2);
+        frameStart += frameSize;
+    }
+}
+
+void WiringControl::beginFrame() {
+    if (frameDepth == 0 && changeOnly && keyframeInterval > 0 && ++framesSinceKeyframe >= keyframeInterval) {
+        framesSinceKeyframe = 0;
+        keyframePending = true;
+    }
+    // Copies of this object do not keep the reserved capacity, so reserve on first use instead of in the constructor
+    if (frameDepth == 0 && pendingFrame.capacity() < PENDING_FRAME_CAPACITY) {
+        pendingFrame.reserve(PENDING_FRAME_CAPACITY);
+    }
+    frameDepth++;
+    for (auto &link: links) {
+        link->beginFrame();
+    }
+    // Restore first, so that the Pico is back in the right protocol before the rest of the frame reaches it
+    if (frameDepth == 1 && serialConnection && serialConnection->takeRestoreRequest()) {
+        restoreConnection();
+    }
+}
+
+void WiringControl::endFrame() {
+    if (frameDepth == 0) {
+        errorLog << "endFrame() called without a matching beginFrame()!" << std::endl;
+        return;
+    }
+    bool acknowledged = ackWindow->isEnabled();
+    if (frameDepth == 1 && acknowledged) {
+        ackWindow->expire(MonotonicClock::now());
+        if (ackWindow->takeRecoveryRequest()) {
+            keyframePending = true;
+        }
+    }
+    if (frameDepth == 1 && keyframePending) {
+        keyframePending = false;
+        refreshOwnPins();
+    }
+    frameDepth--;
+    if (frameDepth == 0 && binaryFrameOpen) {
+        closeBinaryFrame();
+    }
+    if (frameDepth == 0 && !pendingFrame.empty()) {
+        if (acknowledged) {
+            if (!ackWindow->waitForRoom()) {
+                // Frames that time out while waiting are recovered by the next write
+                ackWindow->expire(MonotonicClock::now());
+            }
+            appendSequenceMarker(ackWindow->send(MonotonicClock::now()));
+        }
+        writeToSerial(pendingFrame.data(), pendingFrame.size());
+        pendingFrame.clear();
+    }
+    for (auto &link: links) {
+        link->endFrame();
+    }
+}
+
+void WiringControl::disableAsyncOutput() {
+    serialWriter.reset();
+}
+
+bool WiringControl::flushAsyncOutput(std::chrono::milliseconds timeout) {
+    for (auto &link: links) {
+        if (!link->flushAsyncOutput(timeout)) {
+            return false;
+        }
+    }
+    return !serialWriter || serialWriter->flush(timeout);
+}
+
+SerialWriterStatistics WiringControl::getAsyncOutputStatistics() const {
+    return serialWriter ? serialWriter->getStatistics() : SerialWriterStatistics{};
+}
+
+/// @brief Parse an "Ack <n>" line from the Pico
+static bool parseAckLine(const char *line, std::size_t length, uint8_t &sequence) {
+    const std::size_t prefixLength = 4;
+    if (length <= prefixLength || std::strncmp(line, "Ack ", prefixLength) != 0) {
+        return false;
+    }
+    int value = 0;
+    for (std::size_t i = prefixLength; i < length; i++) {
+        if (line[i] < '0' || line[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (line[i] - '0');
+        if (value > 255) {
+            return false;
+        }
+    }
+    sequence = (uint8_t) value;
+    return true;
+}
+
+bool WiringControl::startReading(SerialReader::LineHandler onLine, SerialReader::FrameHandler onFrame) {
+    if (serial == -1) {
+        return false;
+    }
+    serialReader = std::make_shared<SerialReader>(serial, errorLog);
+    // Captures the shared window rather than this object, which may be a copy that is destroyed first
+    std::shared_ptr<AckWindow> window = ackWindow;
+    serialReader->setLineHandler([window, onLine](const char *line, std::size_t length) {
+        uint8_t sequence;
+        if (parseAckLine(line, length, sequence)) {
+            window->acknowledge(sequence, MonotonicClock::now());
+        } else if (onLine) {
+            onLine(line, length);
+        }
+    });
+    serialReader->setFrameHandler(std::move(onFrame));
+    serialReader->setTrafficCapture(trafficCapture);
+    serialReader->start();
+    if (serialConnection) {
+        // The reader stops when the device hangs up; start it again once the device is back
+        std::weak_ptr<SerialReader> reader = serialReader;
+        serialConnection->setReconnectHandler([reader]() {
+            if (auto activeReader = reader.lock()) {
+                activeReader->start();
+            }
+        });
+    }
+    return true;
+}
+
+void WiringControl::stopReading() {
+    if (serialConnection) {
+        serialConnection->setReconnectHandler(nullptr);
+    }
+    serialReader.reset();
+}
+
+bool WiringControl::isSerialConnected() const {
+    return serialConnection && serialConnection->isConnected();
+}
+
+SerialConnectionStatistics WiringControl::getConnectionStatistics() const {
+    return serialConnection ? serialConnection->getStatistics() : SerialConnectionStatistics{};
+}
+
+void WiringControl::appendSequenceMarker(uint8_t sequence) {
+    if (wireProtocol == BinaryProtocol) {
+        std::size_t markerStart = pendingFrame.size();
+        pendingFrame.push_back((char) BINARY_FRAME_SYNC);
+        pendingFrame.push_back((char) SequenceFrame);
+        pendingFrame.push_back((char) sequence);
+        pendingFrame.push_back(0);
+        auto markerBody = reinterpret_cast<const uint8_t *>(pendingFrame.data() + markerStart + 1);
+        pendingFrame.push_back((char) crc8(markerBody, BINARY_FRAME_HEADER_SIZE - 1));
+    } else {
+        AsciiMessage message;
+        message.text("Seq ").number(sequence).text("\n");
+        pendingFrame.append(message.data(), message.size());
+    }
+}
+
+bool WiringControl::enableAcknowledgements(std::size_t windowSize, std::chrono::milliseconds timeout) {
+    if (windowSize < 1 || windowSize > ACK_WINDOW_MAX_SIZE) {
+        errorLog << "Ack window size must be between 1 and " << ACK_WINDOW_MAX_SIZE << ", not " << windowSize << "!"
+                 << std::endl;
+        return false;
+    }
+    AsciiMessage message;
+    message.text("echo off\nAck on\n");
+    printToSerial(message.data(), message.size());
+    ackWindow->enable(windowSize, timeout);
+    return true;
+}
+
+void WiringControl::disableAcknowledgements() {
+    if (!ackWindow->isEnabled()) {
+        return;
+    }
+    ackWindow->disable();
+    AsciiMessage message;
+    message.text("Ack off\n");
+    printToSerial(message.data(), message.size());
+}
+
+bool WiringControl::processSerialLine(const char *line, std::size_t length) {
+    uint8_t sequence;
+    if (!parseAckLine(line, length, sequence)) {
+        return false;
+    }
+    ackWindow->acknowledge(sequence, MonotonicClock::now());
+    return true;
+}
+
+void WiringControl::retransmitLostFrames() {
+    beginFrame();
+    endFrame();
+}
+
+bool WiringControl::waitForAcknowledgements(std::chrono::milliseconds timeout) {
+    return ackWindow->waitForAll(timeout);
+}
+
+AckStatistics WiringControl::getAcknowledgementStatistics() const {
+    return ackWindow->getStatistics();
+}
+
+void WiringControl::setEventLog(std::shared_ptr<EventLog> log) {
+    eventLog = std::move(log);
+}
+
+EventLog *WiringControl::getEventLog() const {
+    return eventLog.get();
+}
+
+void WiringControl::setTrafficCapture(std::shared_ptr<TrafficCapture> capture) {
+    trafficCapture = std::move(capture);
+}
+
+LinkBudgetStatistics WiringControl::getLinkBudget() const {
+    return linkBudget->getStatistics();
+}
+
+std::size_t WiringControl::estimateFrameBytes(int pwmCount) const {
+    std::size_t bytes;
+    std::size_t marker;
+    if (wireProtocol == BinaryProtocol) {
+        bytes = binaryFrameSize(pwmCount);
+        marker = BINARY_FRAME_HEADER_SIZE + 1;
+    } else {
+        bytes = (std::size_t) pwmCount * std::strlen("Set 29 PWM 1900\n");
+        marker = std::strlen("Seq 255\n");
+    }
+    return ackWindow->isEnabled() ? bytes + marker : bytes;
+}
+
 WiringControl::~WiringControl() {
-#ifndef MOCK_RPI
-    close(serial);
-#endif
+    serialReader.reset();
+    serialWriter.reset();
 }
\ No newline at end of file
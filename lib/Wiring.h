@@ -2,12 +2,29 @@
 
 #pragma once
 
-#include <unordered_map>
+#include <chrono>
 #include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Ack_Window.h"
+#include "Event_Log.h"
+#include "Link_Budget.h"
+#include "Serial_Connection.h"
+#include "Serial_Reader.h"
+#include "Serial_Writer.h"
+#include "Traffic_Capture.h"
+#include "Wire_Protocol.h"
+
+/// @brief Number of GPIO pins on the Raspberry Pi Pico (GPIO 0-29)
+const int PICO_GPIO_COUNT = 30;
+
+/// @brief Most serial links (Picos) one WiringControl can drive. Pin n is GPIO n % 30 on link n / 30.
+const int MAX_SERIAL_LINKS = 4;
 
 /// @brief What purpose the given pin is configured for
 enum PinType {
-    DigitalActiveLow, DigitalActiveHigh, HardwarePWM, SoftwarePWM
+    DigitalActiveLow, DigitalActiveHigh, HardwarePWM, SoftwarePWM, Unconfigured
 };
 
 /// @brief Whether a digital pin is currently low or high
@@ -22,19 +39,149 @@ struct PwmPinStatus {
     int dutyCycle;
 };
 
+/// @brief How messages to the Pico are encoded: human-readable lines, or compact binary frames (see Wire_Protocol.h)
+enum WireProtocol {
+    AsciiProtocol, BinaryProtocol
+};
+
+/// @brief Bytes preallocated for collecting a frame, enough for a full pin initialization in ASCII
+const std::size_t PENDING_FRAME_CAPACITY = 1024;
+
+/// @brief Cached state of every Pico pin, indexed by GPIO number. Everything is stored inline, so a snapshot of the
+/// whole table is a single copy.
+struct PinStateTable {
+    PinType types[PICO_GPIO_COUNT];
+    PwmPinStatus pwmStatuses[PICO_GPIO_COUNT];
+    DigitalPinStatus digitalStatuses[PICO_GPIO_COUNT];
+    /// @brief Whether the Pico is known to hold the cached pwm status (false until the pin is first written after
+    /// being configured)
+    bool pwmStatusKnown[PICO_GPIO_COUNT];
+    /// @brief Whether the Pico is known to hold the cached digital status
+    bool digitalStatusKnown[PICO_GPIO_COUNT];
+
+    PinStateTable() : pwmStatuses{}, digitalStatuses{}, pwmStatusKnown{}, digitalStatusKnown{} {
+        for (PinType &type: types) {
+            type = Unconfigured;
+        }
+    }
+};
+
 class WiringControl {
 private:
     int serial = -1;
-    std::unordered_map<int, PinType> pinTypes;
-    std::unordered_map<int, PwmPinStatus> pwmPinStatuses;
-    std::unordered_map<int, DigitalPinStatus> digitalPinStatuses;
+    PinStateTable pinStates;
+    int frameDepth = 0;
+    std::string pendingFrame;
+    WireProtocol wireProtocol = AsciiProtocol;
+    uint8_t sequenceNumber = 0;
+    bool binaryFrameOpen = false;
+    std::size_t binaryFrameStart = 0;
+    BinaryFrameType binaryFrameType = PwmFrame;
+    int binaryRecordCount = 0;
+    bool changeOnly = false;
+    int keyframeInterval = 0;
+    int framesSinceKeyframe = 0;
+    bool keyframePending = false;
+    long suppressedWrites = 0;
+    std::shared_ptr<SerialWriter> serialWriter;
+    std::shared_ptr<EventLog> eventLog;
+    std::shared_ptr<SerialReader> serialReader;
+    std::shared_ptr<AckWindow> ackWindow;
+    std::shared_ptr<SerialConnection> serialConnection;
+    std::shared_ptr<TrafficCapture> trafficCapture;
+    std::shared_ptr<LinkBudget> linkBudget;
+    /// @brief Links 1 and up; this object is link 0
+    std::vector<std::shared_ptr<WiringControl>> links;
+
+    /// @brief Write bytes to the serial port (or the output stream when there is no serial port), bypassing framing
+    void writeToSerial(const char *data, std::size_t length);
+
+    /// @brief Start a frame for an ASCII message, closing any open binary frame. Must be paired with endFrame().
+    void beginAsciiMessage();
+
+    /// @brief Give the complete binary frames in pendingFrame from the given offset on this object's next sequence
+    /// numbers, recomputing their CRCs
+    void restampBinaryFrames(std::size_t start);
+
+    void sendConfigure(int pinNumber, PinType pinType);
+    void sendDigital(int pinNumber, DigitalPinStatus digitalPinStatus);
+    void sendPwm(int pinNumber, int pulseWidth);
+
+    /// @brief Add a record to the open binary frame, starting a new frame if the open one holds a different kind of
+    /// record (or is full)
+    void appendBinaryRecord(BinaryFrameType frameType, int pinNumber, int value);
+
+    /// @brief Fill in the record count and checksum of the open binary frame
+    void closeBinaryFrame();
+
+    /// @brief Exit with an error if the pin number is not a Pico GPIO number
+    void checkPinNumber(int pinNumber);
+
+    /// @brief The link that owns a pin on link 1 or above, exiting with an error if there is no such link
+    /// @param pinNumber the pin number, which is changed to the GPIO number on the returned link
+    WiringControl &linkFor(int &pinNumber);
+
+    /// @brief Send the cached state of this link's configured pins (but not those of other links) in a single frame
+    void refreshOwnPins();
+
+    /// @brief Append the sequence marker of an acknowledged write to the pending frame
+    void appendSequenceMarker(uint8_t sequence);
+
+    /// @brief Tell a reconnected Pico everything it may have forgotten (ack and protocol modes, pin configurations and
+    /// values), all in the current frame
+    void restoreConnection();
+
+    /// @brief Whether a pin write should be sent to the Pico, given whether it changes the pin's cached value.
+    /// Counts suppressed writes.
+    bool shouldSend(bool changed);
     std::ostream &output;
     std::ostream &outLog;
     std::ostream &errorLog;
 public:
-    /// @brief Perform necessary steps to configure the serial connection from the Pi 5 to the Pico.
+    /// @brief Perform necessary steps to configure the serial connection from the Pi 5 to the Pico, using the default
+    /// SerialConfig
     bool initializeSerial();
 
+    /// @brief Open the serial connection to the Pico on a specific device (e.g. a simulator's pseudo-terminal)
+    /// @param device the path of the serial device
+    /// @param baud the baud rate
+    /// @return True if the device was opened
+    bool initializeSerial(const std::string &device, int baud);
+
+    /// @brief Open the serial connection to the Pico on the first device of the config that can be opened. If the
+    /// config allows it, the device is reopened in the background whenever it disappears; writes made while it is gone
+    /// only update the cached pin state, and the first write after it comes back restores the whole state in one burst.
+    /// Does nothing if the connection is already open.
+    /// @param config where to find the Pico and how to reconnect
+    /// @return True if a device was opened
+    bool initializeSerial(const SerialConfig &config);
+
+    /// @brief Whether the serial connection is open and has not been lost
+    bool isSerialConnected() const;
+
+    /// @brief Disconnect and reconnect counters of the serial connection
+    SerialConnectionStatistics getConnectionStatistics() const;
+
+    /// @brief Drive another Pico through this object. Pins 30-59 go to the first added link, 60-89 to the second, and
+    /// so on. Frames, the wire protocol, change-only writes and refreshes apply to every link; acks, reading, event logs
+    /// and traffic captures are set up on each link separately (see getLink()). pwmWriteEncoded() and compiled
+    /// sequences only address link 0.
+    /// @param link the link, which takes this object's protocol and change-only settings
+    /// @return The index of the link, or -1 if it cannot be added (inside a frame, or past MAX_SERIAL_LINKS)
+    int addLink(std::shared_ptr<WiringControl> link);
+
+    /// @brief Open another Pico's serial connection and add it as a link. Async output is enabled on this object and
+    /// the new link, so each frame is written to all of the links at the same time.
+    /// @param config where to find the Pico and how to reconnect
+    /// @return The index of the link, or -1 if it could not be opened or added
+    int addSerialLink(const SerialConfig &config);
+
+    /// @brief The link with the given index (0 is this object), exiting with an error if there is no such link
+    WiringControl &getLink(int link);
+
+    /// @brief How many links there are, including this object
+    int getLinkCount() const;
+
     /// @brief Sets the pin with the given pin number to the purpose specified: either digital or pwm
     /// @param pinNumber the GPIO number of the pin. See https://pinout.xyz/ or https://pico.pinout.xyz/
     /// @param pinType what the pin will be used for: one of either two types of digital pin or two types pwm pin
@@ -62,6 +209,9 @@ public:
     /// @return The specified pin's frequency, pulse width, and duty cycle
     PwmPinStatus pwmRead(int pinNumber);
 
+    /// @brief A copy of the cached state of every pin
+    PinStateTable getPinStates() const;
+
     /// @brief Set the specified pin the maximum pwm value (1900)
     /// @param pinNumber the GPIO number of the pin. See https://pinout.xyz/ or https://pico.pinout.xyz/
     void pwmWriteMaximum(int pinNumber);
@@ -70,9 +220,138 @@ public:
     /// @param pinNumber the GPIO number of the pin. See https://pinout.xyz/ or https://pico.pinout.xyz/
     void pwmWriteOff(int pinNumber);
 
+    /// @brief Select how messages are encoded from now on. The Pico is told about the switch before any message in the
+    /// new protocol is sent. ASCII is the default and is easiest to debug; binary is roughly 6x smaller.
+    /// @param protocol the protocol to use
+    void setWireProtocol(WireProtocol protocol);
+
+    /// @brief The protocol currently used to encode messages
+    WireProtocol getWireProtocol() const;
+
+    /// @brief Only send pin writes that change a pin's value. Every keyframeInterval frames (where a frame is either a
+    /// single write or everything between beginFrame() and endFrame()), the whole cached pin state is sent instead, so
+    /// that a message lost on the way to the Pico cannot leave a pin in the wrong state for long.
+    /// @param enabled whether unchanged writes should be suppressed
+    /// @param keyframeInterval how many frames between full refreshes, or 0 for no refreshes
+    void setChangeOnly(bool enabled, int keyframeInterval = 50);
+
+    /// @brief How many pin writes were not sent because they did not change the pin's value
+    long getSuppressedWriteCount() const;
+
+    /// @brief Send the cached state of every configured pin to the Pico in a single frame
+    void refreshPins();
+
+    /// @brief Set several pwm pins at once. All of the updates are sent to the Pico in a single serial write.
+    /// @param pinNumbers the GPIO numbers of the pins. See https://pinout.xyz/ or https://pico.pinout.xyz/
+    /// @param pulseWidths the pwm values (between 1100 and 1900) for each pin, in the same order as pinNumbers
+    /// @param count the number of pins to set
+    void pwmWriteFrame(const int *pinNumbers, const int *pulseWidths, int count);
+
+    /// @brief Send a frame that was encoded ahead of time (see Sequence_Compiler.h) and update the cached state of the
+    /// pins it sets. The frame is copied without any formatting; it must be encoded in the current protocol. Binary
+    /// frames get this object's next sequence numbers (and new CRCs), whatever numbers they were encoded with.
+    /// @param frame the encoded frame
+    /// @param length the length of the frame in bytes
+    /// @param pinNumbers the GPIO numbers of the pins the frame sets
+    /// @param pulseWidths the pwm values the frame sets, in the same order as pinNumbers
+    /// @param count the number of pins the frame sets
+    void pwmWriteEncoded(const char *frame, std::size_t length, const int *pinNumbers, const int *pulseWidths,
+                         int count);
+
+    /// @brief Start collecting serial messages into a single frame instead of sending each one as it is made.
+    /// Frames may be nested: messages are only sent once the outermost frame is ended.
+    void beginFrame();
+
+    /// @brief Send every message collected since the matching beginFrame() in one serial write
+    void endFrame();
+
+    /// @brief Hand serial output to a dedicated writer thread instead of writing on the calling thread. Frames are
+    /// queued without blocking; if the queue is full they are dropped and counted as overflows, and every pin is sent
+    /// again with the next frame. Only one thread may
+    /// send messages through this object while async output is enabled. Has no effect until the serial port is open.
+    /// @param capacity how many queue slots (of up to 256 bytes each) the writer can hold
+    /// @return True if async output was enabled
+    bool enableAsyncOutput(std::size_t capacity = 64);
+
+    /// @brief Go back to writing on the calling thread, after writing everything still queued
+    void disableAsyncOutput();
+
+    /// @brief Wait until the writer thread has written everything queued so far
+    /// @param timeout the longest time to wait
+    /// @return True if everything was written in time (or async output is disabled)
+    bool flushAsyncOutput(std::chrono::milliseconds timeout);
+
+    /// @brief Queue depth, overflow and throughput counters of the writer thread
+    SerialWriterStatistics getAsyncOutputStatistics() const;
+
+    /// @brief Start a thread that reads messages (echoes, telemetry) from the Pico and hands each complete line or binary
+    /// frame to a callback. The callbacks run on the reader thread. Has no effect until the serial port is open.
+    /// @param onLine called with each line, without its newline
+    /// @param onFrame called with each binary frame
+    /// @return True if the reader was started
+    bool startReading(SerialReader::LineHandler onLine, SerialReader::FrameHandler onFrame = nullptr);
+
+    /// @brief Stop the reader thread started by startReading()
+    void stopReading();
+
+    /// @brief Ask the Pico to acknowledge every write instead of echoing it. Each write is tagged with a sequence number;
+    /// at most windowSize writes may be unacknowledged at once (a write waits up to the timeout for room). A write that is
+    /// not acknowledged within the timeout counts as lost, and the whole cached pin state is sent again with the next
+    /// write (or by retransmitLostFrames()), so a retransmission can never roll a pin back to an older value.
+    /// @param windowSize how many writes may be unacknowledged at once, between 1 and 128
+    /// @param timeout how long to wait for an ack
+    /// @return False if the window size is out of range
+    bool enableAcknowledgements(std::size_t windowSize = 8,
+                                std::chrono::milliseconds timeout = std::chrono::milliseconds(50));
+
+    /// @brief Go back to unacknowledged writes
+    void disableAcknowledgements();
+
+    /// @brief Handle a line received from the Pico. Acks are consumed; anything else is left to the caller.
+    /// startReading() does this automatically.
+    /// @param line the line, without its newline
+    /// @param length the length of the line
+    /// @return True if the line was an ack
+    bool processSerialLine(const char *line, std::size_t length);
+
+    /// @brief Resend the cached pin state if a write has been lost. Writes do this themselves; call this when no writes
+    /// are being made.
+    void retransmitLostFrames();
+
+    /// @brief Wait until every acknowledged write has been acknowledged or has timed out
+    /// @param timeout the longest time to wait
+    /// @return True if nothing is outstanding
+    bool waitForAcknowledgements(std::chrono::milliseconds timeout);
+
+    /// @brief Delivery counters and round-trip times of acknowledged writes
+    AckStatistics getAcknowledgementStatistics() const;
+
+    /// @brief Record every pin configuration and write made through this object (and its copies) in a binary event log
+    /// @param log the log to record into, or nullptr to stop recording
+    void setEventLog(std::shared_ptr<EventLog> log);
+
+    /// @brief The attached event log, or nullptr if there is none
+    EventLog *getEventLog() const;
+
+    /// @brief Record every frame written to the serial port (or the output stream) through this object and its copies,
+    /// and everything read by startReading(), in a binary traffic capture. Set it before calling startReading() for
+    /// incoming traffic to be recorded.
+    /// @param capture the capture to record into, or nullptr to stop recording
+    void setTrafficCapture(std::shared_ptr<TrafficCapture> capture);
+
+    /// @brief How much of the serial link's capacity (at the baud rate it was opened with) the frames written over the
+    /// last second have used. The capacity is unknown, and the utilization 0, until initializeSerial() is called.
+    LinkBudgetStatistics getLinkBudget() const;
+
+    /// @brief The size of a frame that sets the given number of pwm pins in the current protocol, including its
+    /// sequence marker when acknowledgements are on. ASCII messages are counted with two-digit pin numbers.
+    /// @param pwmCount the number of pins the frame sets
+    std::size_t estimateFrameBytes(int pwmCount) const;
+
     /// @brief Print message to serial specified by file descriptor (which is initialized by initializeSerial())
-    /// @param message a C++ string containing the message to be sent
-    void printToSerial(const std::string &message);
+    /// @param message the characters of the message to be sent
+    /// @param length the number of characters
+    void printToSerial(const char *message, std::size_t length);
 
     /// @param output where you want output (not logging) messages to be sent (probably std::cout)
     /// @param outLog where you want logging (not error) messages to be logged
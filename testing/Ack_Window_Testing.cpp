@@ -0,0 +1,124 @@
+#include "Ack_Window.h"
+#include "Wiring.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+TEST(AckWindowTest, MeasuresRoundTrip) {
+    AckWindow window;
+    window.enable(4, std::chrono::milliseconds(50));
+    auto start = MonotonicClock::now();
+    uint8_t first = window.send(start);
+    uint8_t second = window.send(start);
+    ASSERT_EQ((uint8_t) (first + 1), second);
+    ASSERT_EQ(window.getOutstandingCount(), 2);
+
+    ASSERT_TRUE(window.acknowledge(second, start + std::chrono::milliseconds(3)));
+    ASSERT_TRUE(window.acknowledge(first, start + std::chrono::milliseconds(5)));
+    ASSERT_FALSE(window.acknowledge(first, start + std::chrono::milliseconds(6)));
+
+    AckStatistics statistics = window.getStatistics();
+    ASSERT_EQ(statistics.sent, 2);
+    ASSERT_EQ(statistics.acknowledged, 2);
+    ASSERT_EQ(statistics.unmatchedAcks, 1);
+    ASSERT_EQ(statistics.lastRoundTrip, std::chrono::milliseconds(5));
+    ASSERT_EQ(statistics.maxRoundTrip, std::chrono::milliseconds(5));
+    ASSERT_EQ(window.getOutstandingCount(), 0);
+    ASSERT_FALSE(window.takeRecoveryRequest());
+}
+
+TEST(AckWindowTest, ExpiresLostFrames) {
+    AckWindow window;
+    window.enable(2, std::chrono::milliseconds(10));
+    auto start = MonotonicClock::now();
+    window.send(start);
+    window.send(start + std::chrono::milliseconds(8));
+
+    ASSERT_EQ(window.expire(start + std::chrono::milliseconds(12)), 1);
+    ASSERT_EQ(window.getOutstandingCount(), 1);
+    ASSERT_TRUE(window.takeRecoveryRequest());
+    ASSERT_FALSE(window.takeRecoveryRequest());
+    ASSERT_EQ(window.getStatistics().timedOut, 1);
+}
+
+TEST(AckWindowTest, WaitsForRoom) {
+    AckWindow window;
+    window.enable(1, std::chrono::milliseconds(20));
+    uint8_t sequence = window.send(MonotonicClock::now());
+    std::thread acknowledger([&window, sequence]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        window.acknowledge(sequence, MonotonicClock::now());
+    });
+    ASSERT_TRUE(window.waitForRoom());
+    acknowledger.join();
+    ASSERT_EQ(window.getStatistics().stalls, 1);
+
+    window.send(MonotonicClock::now());
+    ASSERT_FALSE(window.waitForRoom());
+}
+
+TEST(AckWindowTest, WaitForAllExpiresLostFrames) {
+    AckWindow window;
+    window.enable(4, std::chrono::milliseconds(20));
+    auto start = MonotonicClock::now();
+    window.send(start);
+    window.send(start + std::chrono::milliseconds(5));
+
+    // Nobody acks or calls expire(): the wait has to notice the timeouts itself instead of running out the clock
+    ASSERT_TRUE(window.waitForAll(std::chrono::seconds(2)));
+    ASSERT_LT(MonotonicClock::now() - start, std::chrono::seconds(1));
+    ASSERT_EQ(window.getStatistics().timedOut, 2);
+    ASSERT_TRUE(window.takeRecoveryRequest());
+
+    window.send(MonotonicClock::now());
+    ASSERT_FALSE(window.waitForAll(std::chrono::milliseconds(0)));
+}
+
+TEST(WiringTest, AcknowledgedWrites) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl(output, outLog, std::cerr);
+    wiringControl.setPinType(4, HardwarePWM);
+    ASSERT_TRUE(wiringControl.enableAcknowledgements(4, std::chrono::milliseconds(20)));
+    output.str("");
+
+    wiringControl.pwmWrite(4, 1600);
+    ASSERT_EQ(output.str(), "Set 4 PWM 1600\nSeq 0\n");
+    ASSERT_TRUE(wiringControl.processSerialLine("Ack 0", 5));
+    ASSERT_FALSE(wiringControl.processSerialLine("Telemetry 1", 11));
+    ASSERT_TRUE(wiringControl.waitForAcknowledgements(std::chrono::milliseconds(0)));
+
+    // A lost write is recovered by resending every pin's current value
+    wiringControl.pwmWrite(4, 1700);
+    std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    output.str("");
+    wiringControl.retransmitLostFrames();
+    ASSERT_EQ(output.str(), "Set 4 PWM 1700\nSeq 2\n");
+
+    AckStatistics statistics = wiringControl.getAcknowledgementStatistics();
+    ASSERT_EQ(statistics.sent, 3);
+    ASSERT_EQ(statistics.acknowledged, 1);
+    ASSERT_EQ(statistics.timedOut, 1);
+}
+
+TEST(WiringTest, AcknowledgedBinaryWrites) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl(output, outLog, std::cerr);
+    wiringControl.setPinType(4, HardwarePWM);
+    wiringControl.setWireProtocol(BinaryProtocol);
+    wiringControl.enableAcknowledgements();
+    output.str("");
+
+    wiringControl.pwmWrite(4, 1600);
+    std::string frame = output.str();
+    // One pwm frame with one record, then an empty sequence frame
+    ASSERT_EQ(frame.size(), binaryFrameSize(1) + binaryFrameSize(0));
+    const char *marker = frame.data() + binaryFrameSize(1);
+    ASSERT_EQ((uint8_t) marker[0], BINARY_FRAME_SYNC);
+    ASSERT_EQ(marker[1], SequenceFrame);
+    ASSERT_EQ(marker[2], 0);
+    ASSERT_EQ((uint8_t) marker[4], crc8(reinterpret_cast<const uint8_t *>(marker) + 1, 3));
+}
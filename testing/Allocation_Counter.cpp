@@ -0,0 +1,43 @@
+#include "Allocation_Counter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// These replacements apply to the whole binary, so they live in their own test executable (propulsion_allocation_test)
+// rather than in propulsion_test. Keeping them in their own translation unit also stops them being inlined next to the
+// matching new expressions, which would mix up malloc/free with new/delete in the compiler's eyes.
+
+static std::atomic<long> allocationCount(0);
+
+long getAllocationCount() {
+    return allocationCount.load();
+}
+
+void *operator new(std::size_t size) {
+    allocationCount++;
+    void *memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    operator delete(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    operator delete(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept {
+    operator delete(memory);
+}
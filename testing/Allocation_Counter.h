@@ -0,0 +1,5 @@
+#pragma once
+
+/// @brief Number of heap allocations (calls to the global operator new) made by the program so far. Only available in
+/// test binaries that link Allocation_Counter.cpp, which replaces the global operator new and delete.
+long getAllocationCount();
@@ -0,0 +1,53 @@
+#include "Allocation_Counter.h"
+#include "Command_Interpreter.h"
+#include "Test_Interpreter.h"
+#include <gtest/gtest.h>
+#include <array>
+#include <fstream>
+#include <vector>
+
+TEST(AllocationTest, SteadyStateExecutionDoesNotAllocate) {
+    std::ofstream outLog("/dev/null");
+    std::ofstream output("/dev/null");
+
+    auto digitalPins = std::vector<DigitalPin *>{new DigitalPin(28, ActiveLow, output, outLog, std::cerr)};
+    auto interpreter = makeTestInterpreter(output, outLog, AsciiProtocol, 0, digitalPins);
+
+    // Both sides of the deadband and both extremes, repeated across however many thrusters there are
+    const int forwardPattern[8] = {1900, 1900, 1100, 1250, 1300, 1464, 1535, 1536};
+    pwm_array forwards{};
+    std::array<int, THRUSTER_COUNT> backwards{};
+    std::vector<int> expectedPins;
+    for (int i = 0; i < THRUSTER_COUNT; i++) {
+        forwards.pwm_signals[i] = forwardPattern[i % 8];
+        backwards[i] = 3000 - forwardPattern[i % 8];
+        expectedPins.push_back(forwardPattern[i % 8]);
+    }
+    expectedPins.push_back(1);
+    const CommandComponent command = {forwards, std::chrono::milliseconds(1)};
+    std::vector<int> pinValues;
+    std::array<int, THRUSTER_COUNT> thrusterValues{};
+
+    // Let buffers grow to their steady-state size
+    interpreter->untimed_execute(forwards);
+    interpreter->readPins(pinValues);
+
+    long allocationsBefore = getAllocationCount();
+    for (int i = 0; i < 100; i++) {
+        interpreter->untimed_execute(forwards);
+        interpreter->untimed_execute(backwards);
+        interpreter->blind_execute(command);
+        interpreter->readPins(pinValues);
+        thrusterValues = interpreter->readThrusterPins();
+    }
+    long allocations = getAllocationCount() - allocationsBefore;
+    delete interpreter;
+
+    // Setting up the interpreter allocates, which shows the counter is working
+    ASSERT_GT(allocationsBefore, 0);
+    ASSERT_EQ(allocations, 0);
+    ASSERT_EQ(pinValues, expectedPins);
+    for (int i = 0; i < THRUSTER_COUNT; i++) {
+        ASSERT_EQ(thrusterValues[i], forwards.pwm_signals[i]);
+    }
+}
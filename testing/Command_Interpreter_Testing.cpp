@@ -1,5 +1,9 @@
 #include "Command_Interpreter.h"
+#include "Test_Interpreter.h"
 #include <gtest/gtest.h>
+#include <atomic>
+#include <sstream>
+#include <thread>
 
 #ifndef MOCK_RPI
 
@@ -23,19 +27,8 @@ TEST(CommandInterpreterTest, CreateCommandInterpreter) {
     int serial = -1;
     initializeSerial(&serial);
 
-    auto pinNumbers = std::vector<int>{4, 5, 2, 3, 9, 7, 8, 6};
-
-    auto pins = std::vector<PwmPin *>{};
-
-    for (int pinNumber: pinNumbers) {
-        pins.push_back(new HardwarePwmPin(pinNumber, std::cout, outLog, std::cerr));
-    }
-
-    WiringControl wiringControl = WiringControl(std::cout, outLog, std::cerr);
-
-    auto interpreter = new Command_Interpreter_RPi5(pins, std::vector<DigitalPin *>{}, wiringControl, std::cout, outLog,
-                                                    std::cerr);
-    interpreter->initializePins();
+    auto pinNumbers = testThrusterPins();
+    auto interpreter = makeTestInterpreter(std::cout, outLog);
     auto pinStatus = interpreter->readPins();
     std::string output = testing::internal::GetCapturedStdout();
 
@@ -56,8 +49,8 @@ TEST(CommandInterpreterTest, CreateCommandInterpreter) {
         serialOutput.push_back((char) charRead);
     }
 
-    ASSERT_EQ(pinStatus.size(), 8);
-    ASSERT_EQ(pinStatus, (std::vector<int>{1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500}));
+    ASSERT_EQ(pinStatus.size(), THRUSTER_COUNT);
+    ASSERT_EQ(pinStatus, std::vector<int>(THRUSTER_COUNT, 1500));
     if (serialOutput.empty()) {
         ASSERT_EQ(output, expectedOutput);
     } else {
@@ -72,23 +65,10 @@ TEST(CommandInterpreterTest, CreateCommandInterpreterWithDigitalPins) {
     int serial = -1;
     initializeSerial(&serial);
 
-    auto pinNumbers = std::vector<int>{4, 5, 2, 3, 9, 7, 8, 6};
-
-    auto pwmPins = std::vector<PwmPin *>{};
-
-    for (int pinNumber: pinNumbers) {
-        pwmPins.push_back(new HardwarePwmPin(pinNumber, std::cout, outLog, std::cerr));
-    }
-
-    WiringControl wiringControl = WiringControl(std::cout, outLog, std::cerr);
-
-    auto digital1 = new DigitalPin(8, ActiveLow, std::cout, outLog, std::cerr);
-    auto digital2 = new DigitalPin(9, ActiveHigh, std::cout, outLog, std::cerr);
-    auto digitalPins = std::vector<DigitalPin *>{digital1, digital2};
-
-    auto interpreter = new Command_Interpreter_RPi5(pwmPins, digitalPins, wiringControl, std::cout, outLog,
-                                                    std::cerr);
-    interpreter->initializePins();
+    auto pinNumbers = testThrusterPins();
+    auto digital1 = new DigitalPin(20, ActiveLow, std::cout, outLog, std::cerr);
+    auto digital2 = new DigitalPin(21, ActiveHigh, std::cout, outLog, std::cerr);
+    auto interpreter = makeTestInterpreter(std::cout, outLog, AsciiProtocol, 0, {digital1, digital2});
     std::string output = testing::internal::GetCapturedStdout();
     auto pinStatus = interpreter->readPins();
 
@@ -102,16 +82,19 @@ TEST(CommandInterpreterTest, CreateCommandInterpreterWithDigitalPins) {
         expectedOutput.append(std::to_string(pinNumber));
         expectedOutput.append(" PWM 1500\n");
     }
-    expectedOutput.append("Configure 8 Digital\nSet 8 Digital High\n");
-    expectedOutput.append("Configure 9 Digital\nSet 9 Digital Low\n");
+    expectedOutput.append("Configure 20 Digital\nSet 20 Digital High\n");
+    expectedOutput.append("Configure 21 Digital\nSet 21 Digital Low\n");
 
     int charRead = EOF;
     std::string serialOutput;
     while ((charRead = getSerialChar(&serial)) != EOF) {
         serialOutput.push_back((char) charRead);
     }
-    ASSERT_EQ(pinStatus.size(), 10);
-    ASSERT_EQ(pinStatus, (std::vector<int>{1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500, 1, 0}));
+    std::vector<int> expectedStatus(THRUSTER_COUNT, 1500);
+    expectedStatus.push_back(1);
+    expectedStatus.push_back(0);
+    ASSERT_EQ(pinStatus.size(), THRUSTER_COUNT + 2);
+    ASSERT_EQ(pinStatus, expectedStatus);
     if (serialOutput.empty()) {
         ASSERT_EQ(output, expectedOutput);
     } else {
@@ -126,21 +109,10 @@ TEST(CommandInterpreterTest, UntimedExecute) {
     int serial = -1;
     initializeSerial(&serial);
 
-    const pwm_array pwms = {1900, 1900, 1100, 1250, 1300, 1464, 1535, 1536};
-
-    auto pinNumbers = std::vector<int>{4, 5, 2, 3, 9, 7, 8, 6};
-
-    auto pins = std::vector<PwmPin *>{};
-
-    for (int pinNumber: pinNumbers) {
-        pins.push_back(new HardwarePwmPin(pinNumber, std::cout, outLog, std::cerr));
-    }
+    const pwm_array pwms = repeatPwms({1900, 1900, 1100, 1250, 1300, 1464, 1535, 1536});
 
-    WiringControl wiringControl = WiringControl(std::cout, outLog, std::cerr);
-
-    auto interpreter = new Command_Interpreter_RPi5(pins, std::vector<DigitalPin *>{}, wiringControl, std::cout, outLog,
-                                                    std::cerr);
-    interpreter->initializePins();
+    auto pinNumbers = testThrusterPins();
+    auto interpreter = makeTestInterpreter(std::cout, outLog);
     interpreter->untimed_execute(pwms);
     std::string output = testing::internal::GetCapturedStdout();
     auto pinStatus = interpreter->readPins();
@@ -155,21 +127,17 @@ TEST(CommandInterpreterTest, UntimedExecute) {
         expectedOutput.append(std::to_string(pinNumber));
         expectedOutput.append(" PWM 1500\n");
     }
-    expectedOutput.append("Set 4 PWM 1900\n");
-    expectedOutput.append("Set 5 PWM 1900\n");
-    expectedOutput.append("Set 2 PWM 1100\n");
-    expectedOutput.append("Set 3 PWM 1250\n");
-    expectedOutput.append("Set 9 PWM 1300\n");
-    expectedOutput.append("Set 7 PWM 1464\n");
-    expectedOutput.append("Set 8 PWM 1535\n");
-    expectedOutput.append("Set 6 PWM 1536\n");
+    for (int i = 0; i < THRUSTER_COUNT; i++) {
+        expectedOutput.append("Set " + std::to_string(pinNumbers[i]) + " PWM " +
+                              std::to_string(pwms.pwm_signals[i]) + "\n");
+    }
 
     int charRead = EOF;
     std::string serialOutput;
     while ((charRead = getSerialChar(&serial)) != EOF) {
         serialOutput.push_back((char) charRead);
     }
-    ASSERT_EQ(pinStatus, (std::vector<int>{1900, 1900, 1100, 1250, 1300, 1464, 1535, 1536}));
+    ASSERT_EQ(pinStatus, pwmValues(pwms));
     if (serialOutput.empty()) {
         ASSERT_EQ(output, expectedOutput);
     } else {
@@ -184,23 +152,11 @@ TEST(CommandInterpreterTest, BlindExecuteHardwarePwm) {
     int serial = -1;
     initializeSerial(&serial);
 
-    const CommandComponent acceleration = {1900, 1900, 1100,
-                                           1250, 1300, 1464, 1535,
-                                           1536, std::chrono::milliseconds(2000)};
-
-    auto pinNumbers = std::vector<int>{4, 5, 2, 3, 9, 7, 8, 6};
-
-    auto pins = std::vector<PwmPin *>{};
-
-    for (int pinNumber: pinNumbers) {
-        pins.push_back(new HardwarePwmPin(pinNumber, std::cout, outLog, std::cerr));
-    }
-
-    WiringControl wiringControl = WiringControl(std::cout, outLog, std::cerr);
+    const CommandComponent acceleration = {repeatPwms({1900, 1900, 1100, 1250, 1300, 1464, 1535, 1536}),
+                                           std::chrono::milliseconds(2000)};
 
-    auto interpreter = new Command_Interpreter_RPi5(pins, std::vector<DigitalPin *>{}, wiringControl, std::cout, outLog,
-                                                    std::cerr);
-    interpreter->initializePins();
+    auto pinNumbers = testThrusterPins();
+    auto interpreter = makeTestInterpreter(std::cout, outLog);
     auto startTime = std::chrono::system_clock::now();
     interpreter->blind_execute(acceleration);
     auto endTime = std::chrono::system_clock::now();
@@ -217,14 +173,10 @@ TEST(CommandInterpreterTest, BlindExecuteHardwarePwm) {
         expectedOutput.append(std::to_string(pinNumber));
         expectedOutput.append(" PWM 1500\n");
     }
-    expectedOutput.append("Set 4 PWM 1900\n");
-    expectedOutput.append("Set 5 PWM 1900\n");
-    expectedOutput.append("Set 2 PWM 1100\n");
-    expectedOutput.append("Set 3 PWM 1250\n");
-    expectedOutput.append("Set 9 PWM 1300\n");
-    expectedOutput.append("Set 7 PWM 1464\n");
-    expectedOutput.append("Set 8 PWM 1535\n");
-    expectedOutput.append("Set 6 PWM 1536\n");
+    for (int i = 0; i < THRUSTER_COUNT; i++) {
+        expectedOutput.append("Set " + std::to_string(pinNumbers[i]) + " PWM " +
+                              std::to_string(acceleration.thruster_pwms.pwm_signals[i]) + "\n");
+    }
 
     int charRead = EOF;
     std::string serialOutput;
@@ -234,7 +186,7 @@ TEST(CommandInterpreterTest, BlindExecuteHardwarePwm) {
     ASSERT_NEAR((endTime - startTime) / std::chrono::milliseconds(1), std::chrono::milliseconds(2000) /
                                                                       std::chrono::milliseconds(1),
                 std::chrono::milliseconds(10) / std::chrono::milliseconds(1));
-    ASSERT_EQ(pinStatus, (std::vector<int>{1900, 1900, 1100, 1250, 1300, 1464, 1535, 1536}));
+    ASSERT_EQ(pinStatus, pwmValues(acceleration.thruster_pwms));
     if (serialOutput.empty()) {
         ASSERT_EQ(output, expectedOutput);
     } else {
@@ -249,23 +201,11 @@ TEST(CommandInterpreterTest, BlindExecuteSoftwarePwm) {
     int serial = -1;
     initializeSerial(&serial);
 
-    const CommandComponent acceleration = {1100, 1900, 1100,
-                                           1250, 1300, 1464, 1535,
-                                           1536, std::chrono::milliseconds(2000)};
-
-    auto pinNumbers = std::vector<int>{4, 5, 2, 3, 9, 7, 8, 6};
-
-    auto pins = std::vector<PwmPin *>{};
+    const CommandComponent acceleration = {repeatPwms({1100, 1900, 1100, 1250, 1300, 1464, 1535, 1536}),
+                                           std::chrono::milliseconds(2000)};
 
-    for (int pinNumber: pinNumbers) {
-        pins.push_back(new SoftwarePwmPin(pinNumber, std::cout, outLog, std::cerr));
-    }
-
-    WiringControl wiringControl = WiringControl(std::cout, outLog, std::cerr);
-
-    auto interpreter = new Command_Interpreter_RPi5(pins, std::vector<DigitalPin *>{}, wiringControl, std::cout, outLog,
-                                                    std::cerr);
-    interpreter->initializePins();
+    auto pinNumbers = testThrusterPins();
+    auto interpreter = makeTestInterpreter(std::cout, outLog, AsciiProtocol, 0, {}, SoftwarePWM);
     auto startTime = std::chrono::system_clock::now();
     interpreter->blind_execute(acceleration);
     auto endTime = std::chrono::system_clock::now();
@@ -282,14 +222,10 @@ TEST(CommandInterpreterTest, BlindExecuteSoftwarePwm) {
         expectedOutput.append(std::to_string(pinNumber));
         expectedOutput.append(" PWM 1500\n");
     }
-    expectedOutput.append("Set 4 PWM 1100\n");
-    expectedOutput.append("Set 5 PWM 1900\n");
-    expectedOutput.append("Set 2 PWM 1100\n");
-    expectedOutput.append("Set 3 PWM 1250\n");
-    expectedOutput.append("Set 9 PWM 1300\n");
-    expectedOutput.append("Set 7 PWM 1464\n");
-    expectedOutput.append("Set 8 PWM 1535\n");
-    expectedOutput.append("Set 6 PWM 1536\n");
+    for (int i = 0; i < THRUSTER_COUNT; i++) {
+        expectedOutput.append("Set " + std::to_string(pinNumbers[i]) + " PWM " +
+                              std::to_string(acceleration.thruster_pwms.pwm_signals[i]) + "\n");
+    }
 
     int charRead = EOF;
     std::string serialOutput;
@@ -300,7 +236,7 @@ TEST(CommandInterpreterTest, BlindExecuteSoftwarePwm) {
                                                                       std::chrono::milliseconds(1),
                 std::chrono::milliseconds(10) / std::chrono::milliseconds(1));
 
-    ASSERT_EQ(pinStatus, (std::vector<int>{1100, 1900, 1100, 1250, 1300, 1464, 1535, 1536}));
+    ASSERT_EQ(pinStatus, pwmValues(acceleration.thruster_pwms));
     if (serialOutput.empty()) {
         ASSERT_EQ(output, expectedOutput);
     } else {
@@ -309,3 +245,184 @@ TEST(CommandInterpreterTest, BlindExecuteSoftwarePwm) {
     }
 }
 
+
+/// @brief Stream buffer that counts how many separate writes reach it
+class WriteCountingBuffer : public std::stringbuf {
+public:
+    int writes = 0;
+protected:
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        writes++;
+        return std::stringbuf::xsputn(s, n);
+    }
+};
+
+TEST(CommandInterpreterTest, UntimedExecuteSendsSingleFrame) {
+    std::ofstream outLog("/dev/null");
+    WriteCountingBuffer buffer;
+    std::ostream output(&buffer);
+
+    const std::array<int, THRUSTER_COUNT> pinNumbers = testThrusterPins();
+    const pwm_array pwms = repeatPwms({1900, 1900, 1100, 1250, 1300, 1464, 1535, 1536});
+
+    auto thrusterPins = std::vector<PwmPin *>{};
+    for (int pinNumber: pinNumbers) {
+        thrusterPins.push_back(new HardwarePwmPin(pinNumber, output, outLog, std::cerr));
+    }
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+    Command_Interpreter_RPi5 interpreter(thrusterPins, {}, wiringControl, output, outLog, std::cerr);
+    interpreter.initializePins();
+    ASSERT_EQ(buffer.writes, 1);
+
+    interpreter.untimed_execute(pwms);
+    ASSERT_EQ(buffer.writes, 2);
+
+    std::string expectedOutput;
+    for (int pinNumber: pinNumbers) {
+        expectedOutput.append("Configure " + std::to_string(pinNumber) + " HardPwm\n");
+        expectedOutput.append("Set " + std::to_string(pinNumber) + " PWM 1500\n");
+    }
+    for (int i = 0; i < THRUSTER_COUNT; i++) {
+        expectedOutput.append("Set " + std::to_string(pinNumbers[i]) + " PWM " +
+                              std::to_string(pwms.pwm_signals[i]) + "\n");
+    }
+    ASSERT_EQ(buffer.str(), expectedOutput);
+    ASSERT_EQ(interpreter.readPins(), pwmValues(pwms));
+}
+
+/// @brief A command whose three phases all use the given pwm values, with the given durations in milliseconds
+static Command makeCommand(const pwm_array &pwms, int accelerationMs, int steadyMs, int decelerationMs) {
+    return Command{CommandComponent{pwms, std::chrono::milliseconds(accelerationMs)},
+                   CommandComponent{pwms, std::chrono::milliseconds(steadyMs)},
+                   CommandComponent{pwms, std::chrono::milliseconds(decelerationMs)}};
+}
+
+TEST(CommandInterpreterTest, ExecuteSequence) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+
+    auto interpreter = makeTestInterpreter(output, outLog);
+
+    const pwm_array forwards = repeatPwms({1600, 1600, 1600, 1600, 1500, 1500, 1500, 1500});
+    const pwm_array backwards = repeatPwms({1400, 1400, 1400, 1400, 1500, 1500, 1500, 1500});
+    Sequence sequence;
+    for (int i = 0; i < 20; i++) {
+        sequence.commands.push_back(makeCommand(i % 2 == 0 ? forwards : backwards, 2, 5, i % 3 == 0 ? 0 : 3));
+    }
+
+    auto report = interpreter->execute(sequence);
+    auto pinStatus = interpreter->readPins();
+    delete interpreter;
+
+    ASSERT_FALSE(report.interrupted);
+    ASSERT_EQ(report.phases.size(), 53);
+    ASSERT_EQ(report.scheduledDuration, std::chrono::milliseconds(179));
+    ASSERT_NEAR(report.actualDuration.count(), report.scheduledDuration.count(),
+                std::chrono::nanoseconds(std::chrono::milliseconds(10)).count());
+    // A late phase must not push back the ones after it
+    ASSERT_LT(report.phases.back().lateness(), std::chrono::milliseconds(10));
+    // The first command has no deceleration phase, so the second command starts straight after its steady state
+    ASSERT_EQ(report.phases[1].phase, SteadyStatePhase);
+    ASSERT_EQ(report.phases[2].commandIndex, 1);
+    ASSERT_EQ(report.phases[2].phase, AccelerationPhase);
+    ASSERT_EQ(report.phases[2].scheduledStart, std::chrono::milliseconds(7));
+    ASSERT_EQ(pinStatus, pwmValues(backwards));
+}
+
+TEST(CommandInterpreterTest, InterruptSequence) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+
+    auto interpreter = makeTestInterpreter(output, outLog);
+
+    const pwm_array forwards = repeatPwms({1600, 1600, 1600, 1600, 1500, 1500, 1500, 1500});
+    Sequence sequence;
+    sequence.commands.push_back(makeCommand(forwards, 1000, 1000, 1000));
+
+    std::thread interrupter([interpreter]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        interpreter->interruptBlind_Execute();
+    });
+    auto report = interpreter->execute(sequence);
+    interrupter.join();
+    delete interpreter;
+
+    ASSERT_TRUE(report.interrupted);
+    ASSERT_EQ(report.phases.size(), 1);
+    ASSERT_LT(report.actualDuration, std::chrono::milliseconds(500));
+}
+
+TEST(CommandInterpreterTest, EmergencyStopDuringBlindExecute) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+
+    auto interpreter = makeTestInterpreter(output, outLog);
+
+    const CommandComponent forwards = {repeatPwms({1900, 1900, 1900, 1900, 1100, 1100, 1100, 1100}),
+                                       std::chrono::seconds(5)};
+    auto start = MonotonicClock::now();
+    std::thread executor([interpreter, &forwards]() { interpreter->blind_execute(forwards); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    interpreter->emergencyStop();
+    executor.join();
+    auto elapsed = MonotonicClock::now() - start;
+
+    auto pinStatus = interpreter->readPins();
+    auto statistics = interpreter->getStopStatistics();
+    delete interpreter;
+
+    ASSERT_LT(elapsed, std::chrono::seconds(1));
+    ASSERT_EQ(pinStatus, std::vector<int>(THRUSTER_COUNT, 1500));
+    ASSERT_EQ(statistics.stops, 1);
+    ASSERT_GT(statistics.lastLatency, std::chrono::nanoseconds(0));
+    ASSERT_LT(statistics.maxLatency, std::chrono::milliseconds(5));
+}
+
+TEST(CommandInterpreterTest, WaitStatisticsReadableDuringBlindExecute) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+
+    auto interpreter = makeTestInterpreter(output, outLog);
+    const CommandComponent shortCommand = {repeatPwms({1600}), std::chrono::milliseconds(5)};
+    const CommandComponent longCommand = {repeatPwms({1700}), std::chrono::milliseconds(300)};
+    std::thread executor([interpreter, &shortCommand, &longCommand]() {
+        interpreter->blind_execute(shortCommand);
+        interpreter->blind_execute(longCommand);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    // Reading the statistics must neither wait for the running command nor race with it
+    auto readStart = MonotonicClock::now();
+    WaitStatistics duringCommand = interpreter->getWaitStatistics();
+    auto readTime = MonotonicClock::now() - readStart;
+    executor.join();
+    WaitStatistics afterCommand = interpreter->getWaitStatistics();
+    delete interpreter;
+
+    ASSERT_LT(readTime, std::chrono::milliseconds(100));
+    ASSERT_EQ(duringCommand.waits, 1);
+    ASSERT_EQ(afterCommand.waits, 2);
+    ASSERT_EQ(afterCommand.interrupted, 0);
+}
+
+TEST(CommandInterpreterTest, EmergencyStopWhileIdle) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+
+    auto interpreter = makeTestInterpreter(output, outLog);
+    interpreter->untimed_execute(repeatPwms({1900, 1900, 1900, 1900, 1100, 1100, 1100, 1100}));
+
+    interpreter->emergencyStop();
+    auto pinStatus = interpreter->readPins();
+    auto statistics = interpreter->getStopStatistics();
+
+    // The stop is not carried over into the next command
+    const CommandComponent forwards = {repeatPwms({1600}), std::chrono::milliseconds(20)};
+    auto start = MonotonicClock::now();
+    interpreter->blind_execute(forwards);
+    auto elapsed = MonotonicClock::now() - start;
+    delete interpreter;
+
+    ASSERT_EQ(pinStatus, std::vector<int>(THRUSTER_COUNT, 1500));
+    ASSERT_EQ(statistics.stops, 1);
+    ASSERT_GE(elapsed, std::chrono::milliseconds(20));
+}
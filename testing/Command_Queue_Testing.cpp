@@ -0,0 +1,127 @@
+#include "Command_Queue.h"
+#include "Test_Interpreter.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+    pwm_array uniform(int pwm) {
+        return repeatPwms({pwm});
+    }
+}
+
+TEST(CommandQueueTest, SendsOnlyTheLatestSetpoint) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    auto interpreter = makeTestInterpreter(output, outLog);
+    CommandQueue queue(*interpreter);
+
+    // A burst that arrives before the sender can run collapses into its newest setpoint
+    for (int pwm = 1100; pwm <= 1900; pwm += 8) {
+        queue.submit(uniform(pwm));
+    }
+    output.str("");
+    queue.start();
+    ASSERT_TRUE(queue.waitUntilIdle(std::chrono::milliseconds(500)));
+    CommandQueueStatistics statistics = queue.getStatistics();
+    auto pinStatus = interpreter->readPins();
+    queue.stop();
+    delete interpreter;
+
+    ASSERT_EQ(statistics.submitted, 101);
+    ASSERT_EQ(statistics.sent, 1);
+    ASSERT_EQ(statistics.superseded, 100);
+    ASSERT_EQ(pinStatus, std::vector<int>(THRUSTER_COUNT, 1900));
+    ASSERT_EQ(output.str().find("1892"), std::string::npos);
+}
+
+TEST(CommandQueueTest, NormalWaitsForHighPriorityHold) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    auto interpreter = makeTestInterpreter(output, outLog);
+    CommandQueue queue(*interpreter);
+    queue.start();
+
+    queue.submit(CommandComponent{uniform(1700), std::chrono::milliseconds(150)}, HighPriority);
+    ASSERT_TRUE(queue.waitUntilIdle(std::chrono::milliseconds(100)));
+    queue.submit(uniform(1300));
+    queue.submit(uniform(1400));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto duringHold = interpreter->readPins();
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    ASSERT_TRUE(queue.waitUntilIdle(std::chrono::milliseconds(100)));
+    auto afterHold = interpreter->readPins();
+
+    // A newer high priority submission replaces the hold straight away
+    queue.submit(CommandComponent{uniform(1800), std::chrono::milliseconds(1000)}, HighPriority);
+    ASSERT_TRUE(queue.waitUntilIdle(std::chrono::milliseconds(100)));
+    queue.submit(CommandComponent{uniform(1200), std::chrono::milliseconds(0)}, HighPriority);
+    ASSERT_TRUE(queue.waitUntilIdle(std::chrono::milliseconds(100)));
+    auto replaced = interpreter->readPins();
+    queue.stop();
+    delete interpreter;
+
+    ASSERT_EQ(duringHold, std::vector<int>(THRUSTER_COUNT, 1700));
+    ASSERT_EQ(afterHold, std::vector<int>(THRUSTER_COUNT, 1400));
+    ASSERT_EQ(replaced, std::vector<int>(THRUSTER_COUNT, 1200));
+}
+
+TEST(CommandQueueTest, IgnoresStopsBeforeStart) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    auto interpreter = makeTestInterpreter(output, outLog);
+    CommandQueue queue(*interpreter);
+    interpreter->emergencyStop();
+    queue.start();
+
+    queue.submit(uniform(1600));
+    ASSERT_TRUE(queue.waitUntilIdle(std::chrono::milliseconds(100)));
+    auto pinStatus = interpreter->readPins();
+    CommandQueueStatistics statistics = queue.getStatistics();
+    queue.stop();
+    delete interpreter;
+
+    ASSERT_EQ(pinStatus, std::vector<int>(THRUSTER_COUNT, 1600));
+    ASSERT_EQ(statistics.dropped, 0);
+    ASSERT_EQ(statistics.sent, 1);
+}
+
+TEST(CommandQueueTest, StopPreemptsPendingSubmissions) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    auto interpreter = makeTestInterpreter(output, outLog);
+    CommandQueue queue(*interpreter);
+    queue.start();
+
+    queue.submit(CommandComponent{uniform(1700), std::chrono::milliseconds(1000)}, HighPriority);
+    ASSERT_TRUE(queue.waitUntilIdle(std::chrono::milliseconds(100)));
+    queue.stop();
+    queue.submit(uniform(1600), HighPriority);
+    queue.submit(uniform(1300));
+    queue.submitStop();
+    queue.start();
+    ASSERT_TRUE(queue.waitUntilIdle(std::chrono::milliseconds(100)));
+    auto stopped = interpreter->readPins();
+
+    // An emergency stop from outside the queue drops the next submission, and the one after that goes through
+    interpreter->emergencyStop();
+    queue.submit(uniform(1600));
+    ASSERT_TRUE(queue.waitUntilIdle(std::chrono::milliseconds(100)));
+    auto afterExternalStop = interpreter->readPins();
+    queue.submit(uniform(1650));
+    ASSERT_TRUE(queue.waitUntilIdle(std::chrono::milliseconds(100)));
+    auto resumed = interpreter->readPins();
+    CommandQueueStatistics statistics = queue.getStatistics();
+    queue.stop();
+    delete interpreter;
+
+    ASSERT_EQ(stopped, std::vector<int>(THRUSTER_COUNT, 1500));
+    ASSERT_EQ(afterExternalStop, std::vector<int>(THRUSTER_COUNT, 1500));
+    ASSERT_EQ(resumed, std::vector<int>(THRUSTER_COUNT, 1650));
+    ASSERT_EQ(statistics.stops, 1);
+    ASSERT_EQ(statistics.superseded, 2);
+    ASSERT_EQ(statistics.dropped, 1);
+    ASSERT_EQ(statistics.sent, 2);
+}
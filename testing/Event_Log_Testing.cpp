@@ -0,0 +1,77 @@
+#include "Event_Log.h"
+#include "Wiring.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+TEST(EventLogTest, RoundTrip) {
+    std::stringstream sink;
+    {
+        EventLog log(sink);
+        log.record(PwmWriteEvent, 4, 1900);
+        log.record(DigitalWriteEvent, 20, 1);
+        log.record(EmergencyStopEvent, 0, 0);
+        log.flush();
+        ASSERT_EQ(log.getRecordedCount(), 3);
+        ASSERT_EQ(log.getDroppedCount(), 0);
+    }
+
+    EventLogHeader header{};
+    ASSERT_TRUE(readEventLogHeader(sink, header));
+    LogEvent events[3];
+    for (LogEvent &event: events) {
+        ASSERT_TRUE(sink.read(reinterpret_cast<char *>(&event), sizeof(event)));
+    }
+    ASSERT_FALSE(sink.read(reinterpret_cast<char *>(&events[0]), sizeof(LogEvent)));
+
+    ASSERT_EQ(events[0].type, PwmWriteEvent);
+    ASSERT_EQ(events[0].pin, 4);
+    ASSERT_EQ(events[0].value, 1900);
+    ASSERT_GE(events[0].timestamp, header.monotonicStart);
+    ASSERT_LE(events[0].timestamp, events[1].timestamp);
+    ASSERT_LE(events[1].timestamp, events[2].timestamp);
+    std::string line = formatEvent(events[0], header);
+    ASSERT_NE(line.find("Thruster at pin 4: 1900"), std::string::npos);
+}
+
+TEST(EventLogTest, CountsDroppedEvents) {
+    std::stringstream sink;
+    // The writer only wakes up every 200 ms, so the queue fills up
+    EventLog log(sink, 4, std::chrono::milliseconds(200));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    for (int i = 0; i < 10; i++) {
+        log.record(PwmWriteEvent, 4, 1500 + i);
+    }
+    ASSERT_EQ(log.getRecordedCount(), 4);
+    ASSERT_EQ(log.getDroppedCount(), 6);
+}
+
+TEST(EventLogTest, WiringControlRecordsWrites) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    std::stringstream sink;
+    auto log = std::make_shared<EventLog>(sink);
+    WiringControl wiringControl(output, outLog, std::cerr);
+    wiringControl.setEventLog(log);
+    wiringControl.setPinType(4, HardwarePWM);
+    wiringControl.pwmWrite(4, 1600);
+    wiringControl.setEventLog(nullptr);
+    wiringControl.pwmWrite(4, 1700);
+    log->flush();
+
+    // Configuring a pwm pin also sets it to neutral
+    ASSERT_EQ(log->getRecordedCount(), 3);
+    EventLogHeader header{};
+    ASSERT_TRUE(readEventLogHeader(sink, header));
+    LogEvent event{};
+    ASSERT_TRUE(sink.read(reinterpret_cast<char *>(&event), sizeof(event)));
+    ASSERT_EQ(event.type, ConfigureEvent);
+    ASSERT_EQ(event.value, HardwarePWM);
+    ASSERT_TRUE(sink.read(reinterpret_cast<char *>(&event), sizeof(event)));
+    ASSERT_EQ(event.type, PwmWriteEvent);
+    ASSERT_EQ(event.value, 1500);
+    ASSERT_TRUE(sink.read(reinterpret_cast<char *>(&event), sizeof(event)));
+    ASSERT_EQ(event.type, PwmWriteEvent);
+    ASSERT_EQ(event.value, 1600);
+}
@@ -0,0 +1,79 @@
+#include "Link_Budget.h"
+#include "Wiring.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+
+TEST(LinkBudgetTest, CapacityAtBaud) {
+    ASSERT_DOUBLE_EQ(linkCapacity(115200), 11520);
+    ASSERT_DOUBLE_EQ(maximumFrameRate(115200, 120), 96);
+    ASSERT_DOUBLE_EQ(maximumFrameRate(0, 120), 0);
+    ASSERT_DOUBLE_EQ(maximumFrameRate(115200, 0), 0);
+}
+
+TEST(LinkBudgetTest, MeasuresOverSlidingWindow) {
+    LinkBudget budget(96000);
+    auto start = MonotonicClock::time_point(std::chrono::seconds(100));
+    ASSERT_EQ(budget.getStatistics(start).bytesPerSecond, 0);
+
+    // 100 frames of 48 bytes over one second: half of what a 96000 baud link can carry
+    for (int i = 0; i < 100; i++) {
+        budget.record(48, start + std::chrono::milliseconds(10 * i));
+    }
+    LinkBudgetStatistics full = budget.getStatistics(start + std::chrono::milliseconds(999));
+    ASSERT_DOUBLE_EQ(full.capacity, 9600);
+    ASSERT_DOUBLE_EQ(full.framesPerSecond, 100);
+    ASSERT_DOUBLE_EQ(full.bytesPerSecond, 4800);
+    ASSERT_DOUBLE_EQ(full.meanFrameBytes, 48);
+    ASSERT_DOUBLE_EQ(full.utilization, 0.5);
+
+    // Young links are measured over their lifetime, and old frames leave the window
+    LinkBudgetStatistics young = budget.getStatistics(start + std::chrono::milliseconds(150));
+    ASSERT_DOUBLE_EQ(young.framesPerSecond, 100);
+    LinkBudgetStatistics later = budget.getStatistics(start + std::chrono::milliseconds(1550));
+    ASSERT_DOUBLE_EQ(later.framesPerSecond, 40);
+    ASSERT_EQ(later.totalFrames, 100);
+    ASSERT_EQ(later.totalBytes, 4800);
+}
+
+TEST(LinkBudgetTest, WiringCountsFrames) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+    SerialConfig config;
+    config.baud = 9600;
+    // Without a Pico (outside the mock build) the frames still go to the output stream, but the baud rate is unknown
+    bool opened = wiringControl.initializeSerial(config);
+
+    int pinNumbers[3] = {4, 5, 12};
+    int pwms[3] = {1600, 1600, 1600};
+    for (int pinNumber: pinNumbers) {
+        wiringControl.setPinType(pinNumber, HardwarePWM);
+    }
+    LinkBudgetStatistics before = wiringControl.getLinkBudget();
+    ASSERT_EQ(before.totalBytes, (long) output.str().size());
+    output.str("");
+    wiringControl.pwmWriteFrame(pinNumbers, pwms, 3);
+    LinkBudgetStatistics after = wiringControl.getLinkBudget();
+    ASSERT_EQ(after.baud, opened ? 9600 : 0);
+    ASSERT_EQ(after.totalFrames - before.totalFrames, 1);
+    ASSERT_EQ(after.totalBytes - before.totalBytes, (long) output.str().size());
+    ASSERT_EQ(after.utilization > 0, opened);
+
+    ASSERT_EQ(wiringControl.estimateFrameBytes(3), 48u);
+    wiringControl.setWireProtocol(BinaryProtocol);
+    ASSERT_EQ(wiringControl.estimateFrameBytes(3), binaryFrameSize(3));
+}
+
+#ifdef MOCK_RPI
+
+TEST(LinkBudgetTest, MockDeviceKeepsBaud) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+    ASSERT_TRUE(wiringControl.initializeSerial("/dev/ttyAMA0", 9600));
+    ASSERT_EQ(wiringControl.getLinkBudget().baud, 9600);
+    ASSERT_FALSE(wiringControl.enableAsyncOutput());
+}
+
+#endif
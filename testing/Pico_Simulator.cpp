@@ -0,0 +1,202 @@
+#include "Pico_Simulator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <pty.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+PicoSimulator::PicoSimulator(const PicoSimulatorOptions &options, std::ostream &errorLog)
+        : errorLog(errorLog), options(options), linkFree(MonotonicClock::now()) {
+    char name[256];
+    if (openpty(&masterFd, &slaveFd, name, nullptr, nullptr) != 0) {
+        errorLog << "Unable to open a pseudo-terminal for the Pico simulator: " << std::strerror(errno) << std::endl;
+        masterFd = slaveFd = -1;
+        return;
+    }
+    slavePath = name;
+    // The simulator's side passes bytes through untouched, like the Pico's USB CDC endpoint
+    struct termios settings{};
+    tcgetattr(masterFd, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(masterFd, TCSANOW, &settings);
+    // The slave stays open here too, so the master never sees a hangup when the host closes and reopens the device
+
+    reader.reset(new SerialReader(masterFd, errorLog));
+    reader->setLineHandler([this](const char *line, std::size_t length) { handleLine(line, length); });
+    reader->setFrameHandler([this](const uint8_t *frame, std::size_t length) { handleFrame(frame, length); });
+    reader->start();
+}
+
+void PicoSimulator::pace(std::size_t length) {
+    if (options.baud <= 0) {
+        return;
+    }
+    // 10 bits per byte: start bit, 8 data bits, stop bit
+    auto transmitTime = std::chrono::nanoseconds((long long) length * 10 * 1000000000LL / options.baud);
+    linkFree = std::max(linkFree, MonotonicClock::now()) + transmitTime;
+    std::this_thread::sleep_until(linkFree);
+}
+
+void PicoSimulator::reply(const char *data, std::size_t length) {
+    while (length > 0) {
+        ssize_t written = write(masterFd, data, length);
+        if (written < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        length -= written;
+    }
+}
+
+void PicoSimulator::configurePin(int pinNumber, PinType pinType) {
+    pins.types[pinNumber] = pinType;
+    if (pinType == HardwarePWM || pinType == SoftwarePWM) {
+        pins.pwmStatuses[pinNumber] = PwmPinStatus{1500, 0, 0};
+        pins.pwmStatusKnown[pinNumber] = true;
+    } else {
+        pins.digitalStatuses[pinNumber] = pinType == DigitalActiveLow ? High : Low;
+        pins.digitalStatusKnown[pinNumber] = true;
+    }
+    statistics.pinUpdates++;
+}
+
+void PicoSimulator::handleLine(const char *line, std::size_t length) {
+    pace(length + 1);
+    std::string message(line, length);
+    char command[16] = {0};
+    char kind[16] = {0};
+    int pinNumber = -1;
+    int value = 0;
+    bool sendAck = false;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    statistics.bytesReceived += (long) length + 1;
+    statistics.lines++;
+    bool echo = options.echo;
+    if (std::sscanf(message.c_str(), "Configure %d %15s", &pinNumber, kind) == 2 && pinNumber >= 0 &&
+        pinNumber < PICO_GPIO_COUNT) {
+        if (std::strcmp(kind, "HardPwm") == 0) {
+            configurePin(pinNumber, HardwarePWM);
+        } else if (std::strcmp(kind, "SoftPwm") == 0) {
+            configurePin(pinNumber, SoftwarePWM);
+        } else {
+            // The ASCII protocol does not say which way round a digital pin is
+            configurePin(pinNumber, DigitalActiveHigh);
+        }
+    } else if (std::sscanf(message.c_str(), "Set %d PWM %d", &pinNumber, &value) == 2 && pinNumber >= 0 &&
+               pinNumber < PICO_GPIO_COUNT) {
+        pins.pwmStatuses[pinNumber].pulseWidth = value;
+        pins.pwmStatusKnown[pinNumber] = true;
+        statistics.pinUpdates++;
+    } else if (std::sscanf(message.c_str(), "Set %d Digital %15s", &pinNumber, kind) == 2 && pinNumber >= 0 &&
+               pinNumber < PICO_GPIO_COUNT) {
+        pins.digitalStatuses[pinNumber] = std::strcmp(kind, "High") == 0 ? High : Low;
+        pins.digitalStatusKnown[pinNumber] = true;
+        statistics.pinUpdates++;
+    } else if (std::sscanf(message.c_str(), "Seq %d", &value) == 1) {
+        sendAck = options.acknowledge;
+    } else if (std::sscanf(message.c_str(), "%15s %15s", command, kind) == 2 && std::strcmp(command, "echo") == 0) {
+        options.echo = std::strcmp(kind, "on") == 0;
+    } else if (std::sscanf(message.c_str(), "%15s %15s", command, kind) == 2 && std::strcmp(command, "Ack") == 0) {
+        options.acknowledge = std::strcmp(kind, "on") == 0;
+    } else if (message != "Protocol Binary") {
+        statistics.unknownMessages++;
+    }
+    updated.notify_all();
+    lock.unlock();
+
+    if (echo) {
+        message.push_back('\n');
+        reply(message.data(), message.size());
+    }
+    if (sendAck) {
+        std::string ack = "Ack " + std::to_string(value) + "\n";
+        reply(ack.data(), ack.size());
+    }
+}
+
+void PicoSimulator::handleFrame(const uint8_t *frame, std::size_t length) {
+    pace(length);
+    auto type = (BinaryFrameType) frame[1];
+    int count = frame[3];
+    bool sendAck = false;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    statistics.bytesReceived += (long) length;
+    statistics.frames++;
+    bool echo = options.echo;
+    for (int i = 0; i < count; i++) {
+        const uint8_t *recordBytes = frame + BINARY_FRAME_HEADER_SIZE + i * BINARY_RECORD_SIZE;
+        auto record = (uint16_t) ((recordBytes[0] << 8) | recordBytes[1]);
+        int pinNumber = binaryRecordPin(record);
+        int value = binaryRecordValue(record);
+        if (pinNumber >= PICO_GPIO_COUNT && type != ProtocolFrame) {
+            statistics.unknownMessages++;
+            continue;
+        }
+        switch (type) {
+            case ConfigureFrame:
+                configurePin(pinNumber, (PinType) value);
+                break;
+            case PwmFrame:
+                pins.pwmStatuses[pinNumber].pulseWidth = value;
+                pins.pwmStatusKnown[pinNumber] = true;
+                statistics.pinUpdates++;
+                break;
+            case DigitalFrame:
+                pins.digitalStatuses[pinNumber] = value ? High : Low;
+                pins.digitalStatusKnown[pinNumber] = true;
+                statistics.pinUpdates++;
+                break;
+            case ProtocolFrame:
+                break;
+            default:
+                statistics.unknownMessages++;
+        }
+    }
+    if (type == SequenceFrame) {
+        sendAck = options.acknowledge;
+    }
+    updated.notify_all();
+    lock.unlock();
+
+    if (echo) {
+        reply(reinterpret_cast<const char *>(frame), length);
+    }
+    if (sendAck) {
+        std::string ack = "Ack " + std::to_string(frame[2]) + "\n";
+        reply(ack.data(), ack.size());
+    }
+}
+
+PinStateTable PicoSimulator::getPinStates() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pins;
+}
+
+PicoSimulatorStatistics PicoSimulator::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+bool PicoSimulator::waitForPinUpdates(long count, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return updated.wait_for(lock, timeout, [this, count]() { return statistics.pinUpdates >= count; });
+}
+
+PicoSimulator::~PicoSimulator() {
+    reader.reset();
+    if (masterFd != -1) {
+        close(slaveFd);
+        close(masterFd);
+    }
+}
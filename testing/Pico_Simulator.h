@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Serial_Reader.h"
+#include "Wiring.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+/// @brief How the simulated Pico behaves
+struct PicoSimulatorOptions {
+    /// @brief Send every received message back, like the Pico's "echo on" mode. The host can also switch this.
+    bool echo = false;
+    /// @brief Answer sequence markers with acks, like the Pico's "Ack on" mode. The host can also switch this.
+    bool acknowledge = false;
+    /// @brief Deliver messages no faster than a UART at this baud rate (10 bits per byte) would, or 0 for no limit
+    int baud = 0;
+};
+
+/// @brief What the simulated Pico has received
+struct PicoSimulatorStatistics {
+    long bytesReceived = 0;
+    long lines = 0;
+    long frames = 0;
+    /// @brief Number of pin configurations and pin writes applied
+    long pinUpdates = 0;
+    /// @brief Messages that could not be understood
+    long unknownMessages = 0;
+};
+
+/// @brief A Raspberry Pi Pico stand-in on a pseudo-terminal. The host side opens devicePath() like the real USB serial
+/// device, so the real serialOpen(), termios settings and file descriptor I/O are exercised. The simulator speaks both
+/// the ASCII and binary protocols, keeps the state of every pin, and can echo, ack and pace messages like the Pico.
+class PicoSimulator {
+private:
+    int masterFd = -1;
+    int slaveFd = -1;
+    std::string slavePath;
+    std::ostream &errorLog;
+    std::unique_ptr<SerialReader> reader;
+
+    mutable std::mutex mutex;
+    std::condition_variable updated;
+    PicoSimulatorOptions options;
+    PinStateTable pins;
+    PicoSimulatorStatistics statistics;
+    MonotonicClock::time_point linkFree;
+
+    /// @brief Wait until a message of the given size would have finished arriving over the simulated UART
+    void pace(std::size_t length);
+
+    void reply(const char *data, std::size_t length);
+
+    void handleLine(const char *line, std::size_t length);
+
+    void handleFrame(const uint8_t *frame, std::size_t length);
+
+    /// @brief Apply a configure or set command to the pin table. The mutex must be held.
+    void configurePin(int pinNumber, PinType pinType);
+
+public:
+    /// @param options how the simulated Pico behaves
+    /// @param errorLog where you want error messages to be logged
+    explicit PicoSimulator(const PicoSimulatorOptions &options, std::ostream &errorLog);
+
+    PicoSimulator(const PicoSimulator &) = delete;
+
+    PicoSimulator &operator=(const PicoSimulator &) = delete;
+
+    /// @brief Whether the pseudo-terminal was created
+    bool isOpen() const { return masterFd != -1; }
+
+    /// @brief The serial device the host should open
+    const std::string &devicePath() const { return slavePath; }
+
+    /// @brief The current state of every pin, as the simulated Pico sees it
+    PinStateTable getPinStates() const;
+
+    PicoSimulatorStatistics getStatistics() const;
+
+    /// @brief Wait until at least the given number of pin updates have been applied
+    /// @param count the number of updates to wait for
+    /// @param timeout the longest time to wait
+    /// @return True if the updates arrived in time
+    bool waitForPinUpdates(long count, std::chrono::milliseconds timeout);
+
+    ~PicoSimulator();
+};
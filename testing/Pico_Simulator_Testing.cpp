@@ -0,0 +1,98 @@
+#include "Pico_Simulator.h"
+#include "Wiring.h"
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+TEST(PicoSimulatorTest, AppliesAsciiCommandsAndAcks) {
+    PicoSimulatorOptions options;
+    options.acknowledge = true;
+    PicoSimulator simulator(options, std::cerr);
+    ASSERT_TRUE(simulator.isOpen());
+
+    int fd = open(simulator.devicePath().c_str(), O_RDWR | O_NOCTTY);
+    ASSERT_NE(fd, -1);
+    std::string commands = "Configure 4 HardPwm\nSet 4 PWM 1600\nConfigure 20 Digital\nSet 20 Digital High\nSeq 7\n";
+    ASSERT_EQ(write(fd, commands.data(), commands.size()), (ssize_t) commands.size());
+    ASSERT_TRUE(simulator.waitForPinUpdates(4, std::chrono::seconds(1)));
+
+    PinStateTable pins = simulator.getPinStates();
+    ASSERT_EQ(pins.types[4], HardwarePWM);
+    ASSERT_EQ(pins.pwmStatuses[4].pulseWidth, 1600);
+    ASSERT_EQ(pins.digitalStatuses[20], High);
+
+    SerialReader reader(fd, std::cerr);
+    std::string ack;
+    reader.setLineHandler([&ack](const char *line, std::size_t length) { ack.assign(line, length); });
+    reader.poll(std::chrono::seconds(1));
+    ASSERT_EQ(ack, "Ack 7");
+    ASSERT_EQ(simulator.getStatistics().unknownMessages, 0);
+    close(fd);
+}
+
+#ifndef MOCK_RPI
+
+/// @brief Configure the eight thruster pins through a real serial connection to the simulator
+static void configureThrusters(WiringControl &wiringControl) {
+    wiringControl.beginFrame();
+    for (int pin = 0; pin < 8; pin++) {
+        wiringControl.setPinType(pin, HardwarePWM);
+    }
+    wiringControl.endFrame();
+}
+
+TEST(PicoSimulatorTest, EndToEndBinaryCommands) {
+    std::ofstream outLog("/dev/null");
+    PicoSimulator simulator(PicoSimulatorOptions{}, std::cerr);
+    WiringControl wiringControl(std::cout, outLog, std::cerr);
+    ASSERT_TRUE(wiringControl.initializeSerial(simulator.devicePath(), 115200));
+    wiringControl.setWireProtocol(BinaryProtocol);
+    configureThrusters(wiringControl);
+
+    const int commands = 200;
+    int pins[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    int pulseWidths[8];
+    auto start = MonotonicClock::now();
+    for (int i = 0; i < commands; i++) {
+        for (int &pulseWidth: pulseWidths) {
+            pulseWidth = 1100 + (i % 800);
+        }
+        wiringControl.pwmWriteFrame(pins, pulseWidths, 8);
+    }
+    ASSERT_TRUE(simulator.waitForPinUpdates(16 + 8 * commands, std::chrono::seconds(5)));
+    auto elapsed = MonotonicClock::now() - start;
+
+    PinStateTable picoPins = simulator.getPinStates();
+    for (int pin = 0; pin < 8; pin++) {
+        ASSERT_EQ(picoPins.pwmStatuses[pin].pulseWidth, 1100 + (commands - 1) % 800);
+    }
+    ASSERT_EQ(simulator.getStatistics().unknownMessages, 0);
+    std::cerr << "[          ] " << commands << " binary commands in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << " us" << std::endl;
+}
+
+TEST(PicoSimulatorTest, AcknowledgedWritesMeasureRoundTrip) {
+    std::ofstream outLog("/dev/null");
+    PicoSimulatorOptions options;
+    // 115200 baud: an 8-thruster ASCII frame takes about 10 ms to cross the link
+    options.baud = 115200;
+    PicoSimulator simulator(options, std::cerr);
+    WiringControl wiringControl(std::cout, outLog, std::cerr);
+    ASSERT_TRUE(wiringControl.initializeSerial(simulator.devicePath(), 115200));
+    ASSERT_TRUE(wiringControl.startReading(nullptr));
+    configureThrusters(wiringControl);
+    ASSERT_TRUE(wiringControl.enableAcknowledgements(8, std::chrono::milliseconds(200)));
+
+    wiringControl.pwmWrite(3, 1700);
+    ASSERT_TRUE(wiringControl.waitForAcknowledgements(std::chrono::seconds(1)));
+    AckStatistics statistics = wiringControl.getAcknowledgementStatistics();
+    ASSERT_EQ(statistics.acknowledged, 1);
+    ASSERT_EQ(statistics.timedOut, 0);
+    ASSERT_GT(statistics.lastRoundTrip, std::chrono::microseconds(0));
+    ASSERT_EQ(simulator.getPinStates().pwmStatuses[3].pulseWidth, 1700);
+}
+
+#endif
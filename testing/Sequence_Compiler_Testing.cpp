@@ -0,0 +1,170 @@
+#include "Command_Interpreter.h"
+#include "Sequence_Compiler.h"
+#include "Test_Interpreter.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+    const std::array<int, THRUSTER_COUNT> compiledPinNumbers = testThrusterPins();
+
+    Sequence makeCompiledTestSequence() {
+        const pwm_array forwards = repeatPwms({1600, 1600, 1600, 1600, 1500, 1500, 1500, 1500});
+        const pwm_array turning = repeatPwms({1700, 1300, 1700, 1300, 1550, 1450, 1550, 1450});
+        Sequence sequence;
+        for (int i = 0; i < 4; i++) {
+            const pwm_array &pwms = i % 2 == 0 ? forwards : turning;
+            sequence.commands.push_back(Command{CommandComponent{pwms, std::chrono::milliseconds(2)},
+                                                CommandComponent{pwms, std::chrono::milliseconds(i % 2 == 0 ? 5 : 0)},
+                                                CommandComponent{pwms, std::chrono::milliseconds(3)}});
+        }
+        return sequence;
+    }
+
+    std::string temporaryPath() {
+        char path[] = "/tmp/compiled_sequence_XXXXXX";
+        int fd = mkstemp(path);
+        close(fd);
+        return path;
+    }
+
+    /// @brief Compile the sequence, replay it, and check the replay sends exactly what execute() sends
+    void checkReplayMatchesExecute(WireProtocol protocol) {
+        std::ofstream outLog("/dev/null");
+        Sequence sequence = makeCompiledTestSequence();
+
+        std::ostringstream liveOutput;
+        auto liveInterpreter = makeTestInterpreter(liveOutput, outLog, protocol);
+        SequenceReport liveReport = liveInterpreter->execute(sequence);
+        delete liveInterpreter;
+
+        std::string path = temporaryPath();
+        {
+            std::ofstream file(path, std::ios::binary);
+            ASSERT_TRUE(compileSequence(sequence, compiledPinNumbers, protocol, file));
+        }
+        CompiledSequence compiled(path, std::cerr);
+        std::remove(path.c_str());
+        ASSERT_TRUE(compiled.isOpen());
+        ASSERT_EQ(compiled.phaseCount(), 10);
+        ASSERT_EQ(compiled.duration(), std::chrono::milliseconds(30));
+
+        std::ostringstream replayOutput;
+        auto replayInterpreter = makeTestInterpreter(replayOutput, outLog, protocol);
+        SequenceReport replayReport = replayInterpreter->execute(compiled);
+        auto pinStatus = replayInterpreter->readPins();
+        delete replayInterpreter;
+
+        ASSERT_FALSE(replayReport.interrupted);
+        ASSERT_EQ(replayOutput.str(), liveOutput.str());
+        ASSERT_EQ(replayReport.phases.size(), liveReport.phases.size());
+        for (std::size_t i = 0; i < replayReport.phases.size(); i++) {
+            ASSERT_EQ(replayReport.phases[i].commandIndex, liveReport.phases[i].commandIndex);
+            ASSERT_EQ(replayReport.phases[i].phase, liveReport.phases[i].phase);
+            ASSERT_EQ(replayReport.phases[i].scheduledStart, liveReport.phases[i].scheduledStart);
+        }
+        ASSERT_EQ(pinStatus, pwmValues(repeatPwms({1700, 1300, 1700, 1300, 1550, 1450, 1550, 1450})));
+    }
+}
+
+TEST(SequenceCompilerTest, AsciiReplayMatchesExecute) {
+    checkReplayMatchesExecute(AsciiProtocol);
+}
+
+TEST(SequenceCompilerTest, BinaryReplayMatchesExecute) {
+    checkReplayMatchesExecute(BinaryProtocol);
+}
+
+TEST(SequenceCompilerTest, BinaryReplayContinuesSequenceNumbers) {
+    std::ofstream outLog("/dev/null");
+    Sequence sequence = makeCompiledTestSequence();
+
+    std::ostringstream liveOutput;
+    auto liveInterpreter = makeTestInterpreter(liveOutput, outLog, BinaryProtocol);
+    liveInterpreter->execute(sequence);
+    liveInterpreter->execute(sequence);
+    delete liveInterpreter;
+
+    std::string path = temporaryPath();
+    {
+        std::ofstream file(path, std::ios::binary);
+        ASSERT_TRUE(compileSequence(sequence, compiledPinNumbers, BinaryProtocol, file));
+    }
+    CompiledSequence compiled(path, std::cerr);
+    std::remove(path.c_str());
+    std::ostringstream replayOutput;
+    auto replayInterpreter = makeTestInterpreter(replayOutput, outLog, BinaryProtocol);
+    replayInterpreter->execute(compiled);
+    replayInterpreter->execute(compiled);
+    delete replayInterpreter;
+
+    // The second replay carries on from the first instead of repeating its sequence numbers
+    ASSERT_EQ(replayOutput.str(), liveOutput.str());
+}
+
+TEST(SequenceCompilerTest, RejectsInvalidFiles) {
+    std::ostringstream errors;
+    std::string path = temporaryPath();
+    {
+        std::ofstream file(path, std::ios::binary);
+        ASSERT_TRUE(compileSequence(makeCompiledTestSequence(), compiledPinNumbers, AsciiProtocol, file));
+    }
+    // Cut the file off in the middle of the phase table
+    ASSERT_EQ(truncate(path.c_str(), 100), 0);
+    CompiledSequence truncated(path, errors);
+    ASSERT_FALSE(truncated.isOpen());
+    std::remove(path.c_str());
+
+    CompiledSequence missing("/tmp/no_such_compiled_sequence", errors);
+    ASSERT_FALSE(missing.isOpen());
+}
+
+TEST(SequenceCompilerTest, RejectsOtherThrusterPins) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    std::ostringstream errors;
+    std::array<int, THRUSTER_COUNT> otherPinNumbers;
+    for (int i = 0; i < THRUSTER_COUNT; i++) {
+        otherPinNumbers[i] = i;
+    }
+    std::string path = temporaryPath();
+    {
+        std::ofstream file(path, std::ios::binary);
+        ASSERT_TRUE(compileSequence(makeCompiledTestSequence(), otherPinNumbers, AsciiProtocol, file));
+    }
+    CompiledSequence compiled(path, std::cerr);
+    std::remove(path.c_str());
+    auto interpreter = makeTestInterpreter(output, outLog, AsciiProtocol);
+    std::string initialization = output.str();
+    SequenceReport report = interpreter->execute(compiled);
+    delete interpreter;
+
+    ASSERT_TRUE(report.interrupted);
+    ASSERT_EQ(output.str(), initialization);
+}
+
+TEST(SequenceCompilerTest, RestoresProtocolAfterReplay) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    std::string path = temporaryPath();
+    {
+        std::ofstream file(path, std::ios::binary);
+        ASSERT_TRUE(compileSequence(makeCompiledTestSequence(), compiledPinNumbers, BinaryProtocol, file));
+    }
+    CompiledSequence compiled(path, std::cerr);
+    std::remove(path.c_str());
+    auto interpreter = makeTestInterpreter(output, outLog, AsciiProtocol);
+    SequenceReport report = interpreter->execute(compiled);
+    output.str("");
+    pwm_array pwms = repeatPwms({1500});
+    pwms.pwm_signals[THRUSTER_COUNT - 1] = 1600;
+    interpreter->untimed_execute(pwms);
+    delete interpreter;
+
+    std::string expected = "Set " + std::to_string(compiledPinNumbers[THRUSTER_COUNT - 1]) + " PWM 1600\n";
+    ASSERT_FALSE(report.interrupted);
+    ASSERT_NE(output.str().find(expected), std::string::npos);
+}
@@ -0,0 +1,168 @@
+#include "Serial_Connection.h"
+#include "Pico_Simulator.h"
+#include "Wiring.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+TEST(SerialConnectionTest, DiscoversDevicesInPatternOrder) {
+    char directory[] = "/tmp/serial_discovery_XXXXXX";
+    ASSERT_NE(mkdtemp(directory), nullptr);
+    std::string base = directory;
+    for (const char *name: {"ttyACM1", "ttyACM0", "pico"}) {
+        std::ofstream(base + "/" + name);
+    }
+
+    std::vector<std::string> devices = discoverSerialDevices(
+            {base + "/missing", base + "/pico", base + "/ttyACM*", base + "/pico"});
+
+    for (const char *name: {"ttyACM1", "ttyACM0", "pico"}) {
+        std::remove((base + "/" + name).c_str());
+    }
+    rmdir(directory);
+
+    ASSERT_EQ(devices, (std::vector<std::string>{base + "/pico", base + "/ttyACM0", base + "/ttyACM1"}));
+}
+
+#ifndef MOCK_RPI
+
+TEST(SerialConnectionTest, FailsWithoutDevice) {
+    std::ofstream outLog("/dev/null");
+    SerialConfig config;
+    config.devices = {"/tmp/no_such_serial_device*"};
+    WiringControl wiringControl(std::cout, outLog, std::cerr);
+    ASSERT_FALSE(wiringControl.initializeSerial(config));
+    ASSERT_FALSE(wiringControl.isSerialConnected());
+}
+
+TEST(SerialConnectionTest, SkipsDevicesHeldByAnotherDriver) {
+    std::ofstream outLog("/dev/null");
+    PicoSimulator first(PicoSimulatorOptions{}, std::cerr);
+    PicoSimulator second(PicoSimulatorOptions{}, std::cerr);
+    SerialConfig config;
+    config.devices = {first.devicePath(), second.devicePath()};
+    config.reconnect = false;
+
+    SerialConnection owner(config, std::cerr);
+    SerialConnection skipping(config, std::cerr);
+    ASSERT_TRUE(owner.open());
+    ASSERT_TRUE(skipping.open());
+    SerialConnection refused(config, std::cerr);
+    ASSERT_FALSE(refused.open());
+
+    ASSERT_EQ(owner.getStatistics().device, first.devicePath());
+    ASSERT_EQ(skipping.getStatistics().device, second.devicePath());
+}
+
+/// @brief Wait until the connection is in the given state
+static bool waitForConnectionState(const WiringControl &wiringControl, bool connected) {
+    auto deadline = MonotonicClock::now() + std::chrono::seconds(2);
+    while (wiringControl.isSerialConnected() != connected) {
+        if (MonotonicClock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+TEST(SerialConnectionTest, ReconnectsAndRestoresPinState) {
+    std::ofstream outLog("/dev/null");
+    char directory[] = "/tmp/serial_reconnect_XXXXXX";
+    ASSERT_NE(mkdtemp(directory), nullptr);
+    std::string link = std::string(directory) + "/pico";
+
+    std::unique_ptr<PicoSimulator> simulator(new PicoSimulator(PicoSimulatorOptions{}, std::cerr));
+    ASSERT_EQ(symlink(simulator->devicePath().c_str(), link.c_str()), 0);
+
+    SerialConfig config;
+    config.devices = {std::string(directory) + "/pico*"};
+    WiringControl wiringControl(std::cout, outLog, std::cerr);
+    ASSERT_TRUE(wiringControl.initializeSerial(config));
+    wiringControl.setWireProtocol(BinaryProtocol);
+    wiringControl.beginFrame();
+    for (int pin = 0; pin < 8; pin++) {
+        wiringControl.setPinType(pin, HardwarePWM);
+    }
+    wiringControl.setPinType(20, DigitalActiveHigh);
+    wiringControl.endFrame();
+    wiringControl.pwmWrite(2, 1700);
+    ASSERT_TRUE(simulator->waitForPinUpdates(19, std::chrono::seconds(1)));
+
+    // Unplug: the Pico and the device go away, and writes only update the cache
+    simulator.reset();
+    ASSERT_TRUE(waitForConnectionState(wiringControl, false));
+    wiringControl.pwmWrite(3, 1300);
+    wiringControl.digitalWrite(20, High);
+    unlink(link.c_str());
+
+    // Replug a freshly started Pico under a new device name
+    simulator.reset(new PicoSimulator(PicoSimulatorOptions{}, std::cerr));
+    ASSERT_EQ(symlink(simulator->devicePath().c_str(), link.c_str()), 0);
+    ASSERT_TRUE(waitForConnectionState(wiringControl, true));
+    wiringControl.retransmitLostFrames();
+    // Nine configurations and nine values
+    ASSERT_TRUE(simulator->waitForPinUpdates(18, std::chrono::seconds(1)));
+
+    PinStateTable picoPins = simulator->getPinStates();
+    SerialConnectionStatistics statistics = wiringControl.getConnectionStatistics();
+    simulator.reset();
+    unlink(link.c_str());
+    rmdir(directory);
+
+    for (int pin = 0; pin < 8; pin++) {
+        ASSERT_EQ(picoPins.types[pin], HardwarePWM);
+    }
+    ASSERT_EQ(picoPins.pwmStatuses[2].pulseWidth, 1700);
+    ASSERT_EQ(picoPins.pwmStatuses[3].pulseWidth, 1300);
+    ASSERT_EQ(picoPins.pwmStatuses[4].pulseWidth, 1500);
+    ASSERT_EQ(picoPins.types[20], DigitalActiveHigh);
+    ASSERT_EQ(picoPins.digitalStatuses[20], High);
+    ASSERT_EQ(statistics.disconnects, 1);
+    ASSERT_EQ(statistics.reconnects, 1);
+    ASSERT_EQ(statistics.droppedWrites, 2);
+    ASSERT_LT(statistics.lastOutage, std::chrono::seconds(1));
+}
+
+TEST(SerialConnectionTest, DrivesTwoPicosThroughLinks) {
+    std::ofstream outLog("/dev/null");
+    PicoSimulator first(PicoSimulatorOptions{}, std::cerr);
+    PicoSimulator second(PicoSimulatorOptions{}, std::cerr);
+
+    WiringControl wiringControl(std::cout, outLog, std::cerr);
+    ASSERT_TRUE(wiringControl.initializeSerial(first.devicePath(), 115200));
+    SerialConfig config;
+    config.devices = {second.devicePath()};
+    config.reconnect = false;
+    ASSERT_EQ(wiringControl.addSerialLink(config), 1);
+    wiringControl.setWireProtocol(BinaryProtocol);
+
+    int pinNumbers[12] = {0, 1, 2, 3, 4, 5, 30, 31, 32, 33, 34, 35};
+    int pwms[12] = {1100, 1200, 1300, 1400, 1500, 1600, 1900, 1800, 1700, 1600, 1500, 1400};
+    wiringControl.beginFrame();
+    for (int pin: pinNumbers) {
+        wiringControl.setPinType(pin, HardwarePWM);
+    }
+    wiringControl.endFrame();
+    wiringControl.pwmWriteFrame(pinNumbers, pwms, 12);
+    ASSERT_TRUE(wiringControl.flushAsyncOutput(std::chrono::seconds(1)));
+    // Six configurations, their neutral values and six new values on each Pico
+    ASSERT_TRUE(first.waitForPinUpdates(18, std::chrono::seconds(1)));
+    ASSERT_TRUE(second.waitForPinUpdates(18, std::chrono::seconds(1)));
+
+    PinStateTable firstPins = first.getPinStates();
+    PinStateTable secondPins = second.getPinStates();
+    for (int i = 0; i < 6; i++) {
+        ASSERT_EQ(firstPins.pwmStatuses[i].pulseWidth, pwms[i]);
+        ASSERT_EQ(secondPins.pwmStatuses[i].pulseWidth, pwms[i + 6]);
+    }
+    ASSERT_EQ(secondPins.types[6], Unconfigured);
+}
+
+#endif
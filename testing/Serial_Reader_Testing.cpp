@@ -0,0 +1,100 @@
+#include "Serial_Reader.h"
+#include "Wire_Protocol.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/// @brief Build a binary pwm frame holding the given pin and pulse width
+static std::string makePwmFrame(int pin, int pulseWidth) {
+    std::string frame;
+    frame.push_back((char) BINARY_FRAME_SYNC);
+    frame.push_back((char) PwmFrame);
+    frame.push_back(7);
+    frame.push_back(1);
+    uint16_t record = encodeBinaryRecord(pin, pulseWidth);
+    frame.push_back((char) (record >> 8));
+    frame.push_back((char) (record & 0xFF));
+    frame.push_back((char) crc8(reinterpret_cast<const uint8_t *>(frame.data()) + 1, frame.size() - 1));
+    return frame;
+}
+
+TEST(SerialReaderTest, SplitsLinesAndFrames) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    SerialReader reader(fds[0], std::cerr);
+    std::vector<std::string> lines;
+    std::vector<std::string> frames;
+    reader.setLineHandler([&lines](const char *line, std::size_t length) { lines.emplace_back(line, length); });
+    reader.setFrameHandler([&frames](const uint8_t *frame, std::size_t length) {
+        frames.emplace_back(reinterpret_cast<const char *>(frame), length);
+    });
+
+    std::string frame = makePwmFrame(4, 1900);
+    std::string input = "Set 4 1900\nAck 1\n" + frame + "Telemetry 12.1";
+    ASSERT_EQ(write(fds[1], input.data(), input.size()), (ssize_t) input.size());
+    ASSERT_EQ(reader.poll(std::chrono::milliseconds(100)), 3);
+    ASSERT_EQ(lines, (std::vector<std::string>{"Set 4 1900", "Ack 1"}));
+    ASSERT_EQ(frames, (std::vector<std::string>{frame}));
+
+    // The partial line is held until its newline arrives
+    ASSERT_EQ(write(fds[1], "V\n", 2), 2);
+    ASSERT_EQ(reader.poll(std::chrono::milliseconds(100)), 1);
+    ASSERT_EQ(lines.back(), "Telemetry 12.1V");
+
+    // Everything arrived in two reads, not one read per byte
+    SerialReaderStatistics statistics = reader.getStatistics();
+    ASSERT_EQ(statistics.reads, 2);
+    ASSERT_EQ(statistics.bytesRead, (long) input.size() + 2);
+
+    close(fds[1]);
+    ASSERT_EQ(reader.poll(std::chrono::milliseconds(100)), -1);
+    close(fds[0]);
+}
+
+TEST(SerialReaderTest, SkipsCorruptFrames) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    SerialReader reader(fds[0], std::cerr);
+    std::vector<std::string> lines;
+    int frames = 0;
+    reader.setLineHandler([&lines](const char *line, std::size_t length) { lines.emplace_back(line, length); });
+    reader.setFrameHandler([&frames](const uint8_t *, std::size_t) { frames++; });
+
+    std::string corrupt = makePwmFrame(4, 1900);
+    corrupt.back() ^= 0xFF;
+    std::string input = corrupt + makePwmFrame(5, 1100) + "Ack 2\n";
+    ASSERT_EQ(write(fds[1], input.data(), input.size()), (ssize_t) input.size());
+    reader.poll(std::chrono::milliseconds(100));
+
+    ASSERT_EQ(frames, 1);
+    ASSERT_GE(reader.getStatistics().checksumErrors, 1);
+    ASSERT_EQ(lines.back(), "Ack 2");
+    close(fds[1]);
+    close(fds[0]);
+}
+
+TEST(SerialReaderTest, ReaderThread) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    std::atomic<int> lines{0};
+    {
+        SerialReader reader(fds[0], std::cerr);
+        reader.setLineHandler([&lines](const char *, std::size_t) { lines++; });
+        reader.start();
+        for (int i = 0; i < 1000; i++) {
+            ASSERT_EQ(write(fds[1], "Set 4 1500\n", 11), 11);
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (lines < 1000 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        reader.stop();
+    }
+    ASSERT_EQ(lines, 1000);
+    close(fds[1]);
+    close(fds[0]);
+}
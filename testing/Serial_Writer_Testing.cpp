@@ -0,0 +1,203 @@
+#include "Ring_Buffer.h"
+#include "Serial_Writer.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+/// @brief Read everything available from a file descriptor until it has been idle for a short while
+static std::string readAvailable(int fd) {
+    std::string result;
+    char buffer[4096];
+    int flags = fcntl(fd, F_GETFL);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    int idlePolls = 0;
+    while (idlePolls < 20) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count > 0) {
+            result.append(buffer, count);
+            idlePolls = 0;
+        } else {
+            idlePolls++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    fcntl(fd, F_SETFL, flags);
+    return result;
+}
+
+TEST(RingBufferTest, PushAndPopInOrder) {
+    RingBuffer<int> ring(3);
+    ASSERT_EQ(ring.capacity(), 4);
+    ASSERT_TRUE(ring.empty());
+
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(ring.push(i));
+    }
+    ASSERT_FALSE(ring.push(4));
+    ASSERT_EQ(ring.size(), 4);
+
+    int value = -1;
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(ring.pop(value));
+        ASSERT_EQ(value, i);
+    }
+    ASSERT_FALSE(ring.pop(value));
+}
+
+TEST(RingBufferTest, ConcurrentProducerAndConsumer) {
+    RingBuffer<long> ring(64);
+    const long count = 200000;
+    long sum = 0;
+    bool ordered = true;
+
+    std::thread consumer([&]() {
+        long expected = 0;
+        long value;
+        while (expected < count) {
+            if (ring.pop(value)) {
+                ordered = ordered && value == expected;
+                sum += value;
+                expected++;
+            } else {
+                // Let the producer run, or on a single core this spins away the rest of its time slice
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (long i = 0; i < count; i++) {
+        while (!ring.push(i)) {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+
+    ASSERT_TRUE(ordered);
+    ASSERT_EQ(sum, count * (count - 1) / 2);
+}
+
+TEST(SerialWriterTest, WritesFramesInOrder) {
+    int pipeFds[2];
+    ASSERT_EQ(pipe(pipeFds), 0);
+
+    std::string expected;
+    {
+        SerialWriter writer(pipeFds[1], 16, std::cerr);
+        for (int i = 0; i < 50; i++) {
+            std::string frame = "Set 4 PWM " + std::to_string(1500 + i) + "\n";
+            ASSERT_TRUE(writer.enqueue(frame.data(), frame.size()));
+            expected.append(frame);
+            if (i % 10 == 9) {
+                ASSERT_TRUE(writer.flush(std::chrono::milliseconds(1000)));
+            }
+        }
+        std::string longFrame(1000, 'x');
+        ASSERT_TRUE(writer.enqueue(longFrame.data(), longFrame.size()));
+        expected.append(longFrame);
+        ASSERT_TRUE(writer.flush(std::chrono::milliseconds(1000)));
+
+        auto statistics = writer.getStatistics();
+        ASSERT_EQ(statistics.framesQueued, 51);
+        ASSERT_EQ(statistics.bytesWritten, (long) expected.size());
+        ASSERT_EQ(statistics.overflows, 0);
+    }
+
+    ASSERT_EQ(readAvailable(pipeFds[0]), expected);
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+}
+
+TEST(SerialWriterTest, DropsFramesWhenFull) {
+    int pipeFds[2];
+    ASSERT_EQ(pipe(pipeFds), 0);
+
+    // Fill the pipe so that the writer thread blocks on its first write
+    int flags = fcntl(pipeFds[1], F_GETFL);
+    fcntl(pipeFds[1], F_SETFL, flags | O_NONBLOCK);
+    std::string filler(4096, '.');
+    while (write(pipeFds[1], filler.data(), filler.size()) > 0) {}
+    fcntl(pipeFds[1], F_SETFL, flags);
+
+    std::ostringstream errorLog;
+    SerialWriter writer(pipeFds[1], 4, errorLog);
+    const std::string frame = "Set 4 PWM 1500\n";
+    bool enqueueReturnedInstantly = true;
+    for (int i = 0; i < 10; i++) {
+        auto start = std::chrono::steady_clock::now();
+        writer.enqueue(frame.data(), frame.size());
+        enqueueReturnedInstantly &= std::chrono::steady_clock::now() - start < std::chrono::milliseconds(50);
+    }
+    ASSERT_TRUE(enqueueReturnedInstantly);
+    ASSERT_GE(writer.getStatistics().overflows, 5);
+    ASSERT_LE(writer.getStatistics().maxDepth, 4);
+
+    std::thread reader([&]() { readAvailable(pipeFds[0]); });
+    ASSERT_TRUE(writer.flush(std::chrono::milliseconds(2000)));
+    reader.join();
+
+    // A later run of dropped frames is logged again
+    std::string firstRun = errorLog.str();
+    ASSERT_NE(firstRun.find("queue full"), std::string::npos);
+    fcntl(pipeFds[1], F_SETFL, flags | O_NONBLOCK);
+    while (write(pipeFds[1], filler.data(), filler.size()) > 0) {}
+    fcntl(pipeFds[1], F_SETFL, flags);
+    for (int i = 0; i < 10; i++) {
+        writer.enqueue(frame.data(), frame.size());
+    }
+    ASSERT_NE(errorLog.str().find("queue full", firstRun.size()), std::string::npos);
+
+    std::thread secondReader([&]() { readAvailable(pipeFds[0]); });
+    ASSERT_TRUE(writer.flush(std::chrono::milliseconds(2000)));
+    secondReader.join();
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+}
+
+TEST(SerialWriterTest, WaitsForFullDescriptorWithoutSpinning) {
+    int pipeFds[2];
+    ASSERT_EQ(pipe(pipeFds), 0);
+    fcntl(pipeFds[1], F_SETFL, fcntl(pipeFds[1], F_GETFL) | O_NONBLOCK);
+    std::string filler(4096, '.');
+    while (write(pipeFds[1], filler.data(), filler.size()) > 0) {}
+
+    // Nobody reads: the write gives up after the timeout
+    const std::string frame = "Set 4 PWM 1500\n";
+    ASSERT_FALSE(writeFully(pipeFds[1], frame.data(), frame.size(), std::chrono::milliseconds(20)));
+    ASSERT_EQ(errno, ETIMEDOUT);
+
+    // A reader that starts late still gets the whole frame
+    std::string received;
+    std::thread reader([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        received = readAvailable(pipeFds[0]);
+    });
+    ASSERT_TRUE(writeFully(pipeFds[1], frame.data(), frame.size(), std::chrono::seconds(1)));
+    reader.join();
+    ASSERT_EQ(received.substr(received.size() - frame.size()), frame);
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+}
+
+TEST(SerialWriterTest, ReportsFailedWrites) {
+    // Writing to a read-only descriptor always fails
+    int fd = open("/dev/null", O_RDONLY);
+    ASSERT_NE(fd, -1);
+    std::atomic<int> failures{0};
+    {
+        SerialWriter writer(fd, 4, std::cerr, [&failures]() { failures++; });
+        const std::string frame = "Set 4 PWM 1500\n";
+        writer.enqueue(frame.data(), frame.size());
+        writer.enqueue(frame.data(), frame.size());
+        ASSERT_TRUE(writer.flush(std::chrono::milliseconds(500)));
+        ASSERT_EQ(writer.getStatistics().writeErrors, 2);
+        ASSERT_EQ(writer.getStatistics().bytesWritten, 0);
+    }
+    close(fd);
+    ASSERT_EQ(failures.load(), 2);
+}
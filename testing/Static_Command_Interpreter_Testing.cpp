@@ -0,0 +1,63 @@
+#include "Static_Command_Interpreter.h"
+#include "Test_Interpreter.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+/// @brief Builds a bank of the first THRUSTER_COUNT test thrusters, the same pins makeTestInterpreter() uses
+template<typename Indices>
+struct TestThrusterBank;
+
+template<std::size_t... I>
+struct TestThrusterBank<std::index_sequence<I...>> {
+    using type = PinBank<HardwarePwmThruster<TEST_THRUSTER_GPIOS[I]>...>;
+};
+
+using TestThrusters = TestThrusterBank<std::make_index_sequence<THRUSTER_COUNT>>::type;
+using TestOutputs = PinBank<DigitalOutput<20, ActiveLow>, DigitalOutput<21, ActiveHigh>>;
+
+static_assert(gpioNumbersUnique(std::array<int, 3>{{1, 2, 3}}), "Distinct pins are unique");
+static_assert(!gpioNumbersUnique(std::array<int, 3>{{1, 2, 1}}), "Repeated pins are caught");
+static_assert(!gpioNumbersValid(std::array<int, 2>{{1, 30}}), "GPIO 30 does not exist on the Pico");
+
+TEST(StaticCommandInterpreterTest, MatchesRuntimeInterpreter) {
+    std::ofstream outLog("/dev/null");
+    const pwm_array pwms = repeatPwms({1900, 1900, 1100, 1250, 1300, 1464, 1535, 1536});
+
+    std::ostringstream staticOutput;
+    Static_Command_Interpreter<TestThrusters, TestOutputs> staticInterpreter(
+            WiringControl(staticOutput, outLog, std::cerr), std::cerr);
+    staticInterpreter.initializePins();
+    staticInterpreter.untimed_execute(pwms);
+
+    std::ostringstream runtimeOutput;
+    auto digitalPins = std::vector<DigitalPin *>{new DigitalPin(20, ActiveLow, runtimeOutput, outLog, std::cerr),
+                                                 new DigitalPin(21, ActiveHigh, runtimeOutput, outLog, std::cerr)};
+    auto runtimeInterpreter = makeTestInterpreter(runtimeOutput, outLog, AsciiProtocol, 0, digitalPins);
+    runtimeInterpreter->untimed_execute(pwms);
+    auto runtimeThrusterPins = runtimeInterpreter->readThrusterPins();
+    delete runtimeInterpreter;
+
+    ASSERT_EQ(staticOutput.str(), runtimeOutput.str());
+    ASSERT_EQ(staticInterpreter.readThrusterPins(), runtimeThrusterPins);
+    ASSERT_EQ(staticInterpreter.readDigitalPins(), (std::array<int, 2>{{High, Low}}));
+}
+
+TEST(StaticCommandInterpreterTest, BlindExecute) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    Static_Command_Interpreter<TestThrusters> interpreter(WiringControl(output, outLog, std::cerr), std::cerr);
+    interpreter.initializePins();
+
+    const CommandComponent command = {repeatPwms({1600, 1600, 1600, 1600, 1400, 1400, 1400, 1400}),
+                                      std::chrono::milliseconds(50)};
+    auto start = MonotonicClock::now();
+    interpreter.blind_execute(command);
+    auto elapsed = MonotonicClock::now() - start;
+
+    ASSERT_GE(elapsed, std::chrono::milliseconds(50));
+    ASSERT_LT(elapsed, std::chrono::milliseconds(60));
+    auto thrusterPins = interpreter.readThrusterPins();
+    ASSERT_EQ(std::vector<int>(thrusterPins.begin(), thrusterPins.end()), pwmValues(command.thruster_pwms));
+}
@@ -0,0 +1,194 @@
+#include "Stream_Controller.h"
+#include "Test_Interpreter.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+    /// @brief Fast enough that streaming at 200 Hz never saturates the link
+    Command_Interpreter_RPi5 *makeStreamInterpreter(std::ostream &output, std::ostream &outLog, int baud = 1000000) {
+        return makeTestInterpreter(output, outLog, AsciiProtocol, baud);
+    }
+}
+
+TEST(StreamControllerTest, RampsMonotonicallyToTarget) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    auto interpreter = makeStreamInterpreter(output, outLog);
+    StreamController controller(*interpreter, 200, std::cerr);
+    controller.start();
+
+    const pwm_array target = repeatPwms({1700, 1700, 1700, 1700, 1300, 1300, 1300, 1300});
+    controller.setTarget(target, std::chrono::milliseconds(100));
+    pwm_array previous = controller.getOutput();
+    bool sawIntermediate = false;
+    auto deadline = MonotonicClock::now() + std::chrono::milliseconds(500);
+    while (MonotonicClock::now() < deadline) {
+        pwm_array current = controller.getOutput();
+        for (int i = 0; i < THRUSTER_COUNT; i++) {
+            if (target.pwm_signals[i] > 1500) {
+                ASSERT_GE(current.pwm_signals[i], previous.pwm_signals[i]);
+            } else {
+                ASSERT_LE(current.pwm_signals[i], previous.pwm_signals[i]);
+            }
+        }
+        if (current.pwm_signals[0] > 1500 && current.pwm_signals[0] < 1700) {
+            sawIntermediate = true;
+        }
+        previous = current;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ASSERT_TRUE(controller.waitUntilSettled(std::chrono::milliseconds(100)));
+    controller.stop();
+    auto pinStatus = interpreter->readPins();
+    StreamStatistics statistics = controller.getStatistics();
+    delete interpreter;
+
+    ASSERT_TRUE(sawIntermediate);
+    ASSERT_EQ(pinStatus, pwmValues(target));
+    // About 100 ticks in half a second at 200 Hz
+    ASSERT_GT(statistics.ticks, 50);
+    ASSERT_EQ(statistics.stops, 0);
+}
+
+TEST(StreamControllerTest, ChangesTargetMidRamp) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    auto interpreter = makeStreamInterpreter(output, outLog);
+    StreamController controller(*interpreter, 200, std::cerr);
+    controller.start();
+
+    controller.setTarget(repeatPwms({1900}), std::chrono::milliseconds(200));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    pwm_array midway = controller.getOutput();
+    controller.setTarget(repeatPwms({1500}), std::chrono::milliseconds(50));
+    // The new ramp starts where the old one was, without jumping
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    pwm_array afterChange = controller.getOutput();
+    ASSERT_TRUE(controller.waitUntilSettled(std::chrono::milliseconds(200)));
+    pwm_array settled = controller.getOutput();
+    controller.stop();
+    delete interpreter;
+
+    ASSERT_GT(midway.pwm_signals[0], 1500);
+    ASSERT_LT(midway.pwm_signals[0], 1900);
+    ASSERT_LE(afterChange.pwm_signals[0], midway.pwm_signals[0] + 20);
+    ASSERT_EQ(settled.pwm_signals[0], 1500);
+}
+
+TEST(StreamControllerTest, RunsCommandPhases) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    auto interpreter = makeStreamInterpreter(output, outLog);
+    StreamController controller(*interpreter, 200, std::cerr);
+    controller.start();
+
+    Command command;
+    command.acceleration = {repeatPwms({1600}), std::chrono::milliseconds(50)};
+    command.steadyState = {repeatPwms({1700}), std::chrono::milliseconds(50)};
+    command.deceleration = {repeatPwms({1550}), std::chrono::milliseconds(50)};
+    auto start = MonotonicClock::now();
+    controller.execute(command);
+    std::this_thread::sleep_for(std::chrono::milliseconds(75));
+    pwm_array steady = controller.getOutput();
+    ASSERT_TRUE(controller.waitUntilSettled(std::chrono::milliseconds(500)));
+    auto elapsed = MonotonicClock::now() - start;
+    pwm_array settled = controller.getOutput();
+    controller.stop();
+    delete interpreter;
+
+    ASSERT_EQ(steady.pwm_signals[0], 1700);
+    ASSERT_EQ(settled.pwm_signals[0], 1550);
+    ASSERT_GE(elapsed, std::chrono::milliseconds(150));
+    ASSERT_LT(elapsed, std::chrono::milliseconds(250));
+}
+
+TEST(StreamControllerTest, UsesChosenWaitStrategy) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    std::ostringstream errors;
+    auto interpreter = makeStreamInterpreter(output, outLog);
+    StreamController controller(*interpreter, 200, errors);
+    auto strategy = new BusyWaitStrategy();
+    ASSERT_TRUE(controller.setWaitStrategy(std::unique_ptr<WaitStrategy>(strategy)));
+    controller.start();
+    controller.setTarget(repeatPwms({1600}), std::chrono::milliseconds(20));
+    ASSERT_TRUE(controller.waitUntilSettled(std::chrono::milliseconds(200)));
+    // The loop thread is using the strategy, so it cannot be swapped out from under it
+    ASSERT_FALSE(controller.setWaitStrategy(std::unique_ptr<WaitStrategy>(new SleepWaitStrategy())));
+    controller.stop();
+    delete interpreter;
+
+    ASSERT_GT(strategy->getStatistics().waits, 0);
+    ASSERT_NE(errors.str().find("Cannot change the wait strategy"), std::string::npos);
+}
+
+TEST(StreamControllerTest, EmergencyStopHaltsStream) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    auto interpreter = makeStreamInterpreter(output, outLog);
+    StreamController controller(*interpreter, 200, std::cerr);
+    controller.start();
+
+    controller.setTarget(repeatPwms({1800}), std::chrono::milliseconds(20));
+    ASSERT_TRUE(controller.waitUntilSettled(std::chrono::milliseconds(200)));
+    interpreter->emergencyStop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto stoppedPins = interpreter->readPins();
+    pwm_array stoppedOutput = controller.getOutput();
+    long ticksWhileStopped = controller.getStatistics().ticks;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(controller.getStatistics().ticks, ticksWhileStopped);
+
+    // A new setpoint resumes streaming from neutral
+    controller.setTarget(repeatPwms({1600}), std::chrono::milliseconds(0));
+    ASSERT_TRUE(controller.waitUntilSettled(std::chrono::milliseconds(200)));
+    controller.stop();
+    auto resumedPins = interpreter->readPins();
+    StreamStatistics statistics = controller.getStatistics();
+    delete interpreter;
+
+    ASSERT_EQ(stoppedPins, std::vector<int>(THRUSTER_COUNT, 1500));
+    ASSERT_EQ(stoppedOutput.pwm_signals[0], 1500);
+    ASSERT_EQ(statistics.stops, 1);
+    ASSERT_EQ(resumedPins, std::vector<int>(THRUSTER_COUNT, 1600));
+}
+
+TEST(StreamControllerTest, AdaptiveRateKeepsLinkBelowTarget) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    std::ostringstream errors;
+    // At 115200 baud (11520 bytes a second) an ASCII update of at most 16 bytes per thruster fits 90 times a second
+    // with 8 thrusters, so 200 Hz is impossible
+    auto interpreter = makeStreamInterpreter(output, outLog, 115200);
+    StreamController controller(*interpreter, 200, errors);
+    ASSERT_NE(errors.str().find("more than the serial link can carry"), std::string::npos);
+    ASSERT_DOUBLE_EQ(interpreter->getMaximumUpdateRate(), 11520.0 / (16 * THRUSTER_COUNT));
+
+    controller.setAdaptiveRate(true, 0.8);
+    controller.start();
+    const pwm_array target = repeatPwms({1700, 1700, 1700, 1700, 1300, 1300, 1300, 1300});
+    controller.setTarget(target, std::chrono::milliseconds(100));
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    ASSERT_TRUE(controller.waitUntilSettled(std::chrono::milliseconds(100)));
+    controller.stop();
+    StreamStatistics statistics = controller.getStatistics();
+    LinkBudgetStatistics budget = interpreter->getLinkBudget();
+    auto pinStatus = interpreter->readPins();
+    delete interpreter;
+
+    // The updates actually sent are shorter (120 bytes with 8 thrusters, so 76.8 a second are allowed and every third
+    // tick is sent). The decimation follows the measured mean frame size, which also counts the initialization frame.
+    std::size_t frameBytes = 0;
+    for (int pinNumber: testThrusterPins()) {
+        frameBytes += ("Set " + std::to_string(pinNumber) + " PWM 1700\n").size();
+    }
+    ASSERT_GE(statistics.decimation, (int) std::ceil(200 / (0.8 * 11520 / frameBytes)));
+    ASSERT_EQ(statistics.decimation, (int) std::ceil(200 / (0.8 * budget.capacity / budget.meanFrameBytes)));
+    ASSERT_GT(statistics.decimatedTicks, statistics.ticks);
+    ASSERT_LT(budget.utilization, 0.8);
+    ASSERT_EQ(pinStatus, pwmValues(target));
+}
@@ -0,0 +1,46 @@
+#include "Test_Interpreter.h"
+#include <iostream>
+#include <utility>
+
+std::array<int, THRUSTER_COUNT> testThrusterPins() {
+    std::array<int, THRUSTER_COUNT> pins{};
+    for (int i = 0; i < THRUSTER_COUNT; i++) {
+        pins[i] = TEST_THRUSTER_GPIOS[i];
+    }
+    return pins;
+}
+
+pwm_array repeatPwms(std::initializer_list<int> pattern) {
+    pwm_array pwms{};
+    for (int i = 0; i < THRUSTER_COUNT; i++) {
+        pwms.pwm_signals[i] = pattern.begin()[i % pattern.size()];
+    }
+    return pwms;
+}
+
+std::vector<int> pwmValues(const pwm_array &pwms) {
+    return std::vector<int>(pwms.pwm_signals, pwms.pwm_signals + THRUSTER_COUNT);
+}
+
+Command_Interpreter_RPi5 *makeTestInterpreter(std::ostream &output, std::ostream &outLog, WireProtocol protocol,
+                                              int baud, std::vector<DigitalPin *> digitalPins, PinType thrusterType) {
+    auto pins = std::vector<PwmPin *>{};
+    for (int pinNumber: testThrusterPins()) {
+        if (thrusterType == SoftwarePWM) {
+            pins.push_back(new SoftwarePwmPin(pinNumber, output, outLog, std::cerr));
+        } else {
+            pins.push_back(new HardwarePwmPin(pinNumber, output, outLog, std::cerr));
+        }
+    }
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+    if (baud != 0) {
+        SerialConfig config;
+        config.baud = baud;
+        wiringControl.initializeSerial(config);
+    }
+    wiringControl.setWireProtocol(protocol);
+    auto interpreter = new Command_Interpreter_RPi5(pins, std::move(digitalPins), wiringControl, output, outLog,
+                                                    std::cerr);
+    interpreter->initializePins();
+    return interpreter;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Command_Interpreter.h"
+#include <array>
+#include <initializer_list>
+#include <ostream>
+#include <vector>
+
+/// @brief GPIO numbers for test thrusters, in order. The first eight are the vehicle's wiring; the rest are spare GPIOs
+/// used when the tests are built for more thrusters. GPIO 20, 21 and 28 are left free for digital pins.
+constexpr int TEST_THRUSTER_GPIOS[] = {4, 5, 2, 3, 9, 7, 8, 6, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 22, 23, 24, 25,
+                                       26, 27};
+
+static_assert(THRUSTER_COUNT <= (int) (sizeof(TEST_THRUSTER_GPIOS) / sizeof(TEST_THRUSTER_GPIOS[0])),
+              "Not enough spare GPIOs for this many test thrusters");
+
+/// @brief The GPIO numbers of the first THRUSTER_COUNT test thrusters
+std::array<int, THRUSTER_COUNT> testThrusterPins();
+
+/// @brief A pwm_array repeating the given values across every thruster
+/// @param pattern the values for the first thrusters; thruster i gets pattern[i % pattern.size()]
+pwm_array repeatPwms(std::initializer_list<int> pattern);
+
+/// @brief The values of a pwm_array, in the order readPins() returns thruster values
+std::vector<int> pwmValues(const pwm_array &pwms);
+
+/// @brief A Command Interpreter driving the test thrusters, with its pins initialized
+/// @param output where messages to the Pico go
+/// @param outLog where the pins log their writes
+/// @param protocol the wire protocol to use from the start
+/// @param baud if not 0, the serial port is opened at this baud rate before the interpreter is created
+/// @param digitalPins digital pins for the interpreter to own, after the thrusters
+/// @param thrusterType HardwarePWM or SoftwarePWM thruster pins
+/// @return The interpreter, to be deleted by the caller
+Command_Interpreter_RPi5 *makeTestInterpreter(std::ostream &output, std::ostream &outLog,
+                                              WireProtocol protocol = AsciiProtocol, int baud = 0,
+                                              std::vector<DigitalPin *> digitalPins = {},
+                                              PinType thrusterType = HardwarePWM);
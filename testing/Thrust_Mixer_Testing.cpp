@@ -0,0 +1,137 @@
+#include "Thrust_Mixer.h"
+#include <gtest/gtest.h>
+#include <chrono>
+
+/// @brief Four horizontal thrusters sharing surge and yaw, four vertical thrusters sharing heave
+static const float TEST_ALLOCATION[MIXER_THRUSTER_COUNT][WRENCH_AXES] = {
+        {0.25f, 0, 0, 0, 0, 0.5f},
+        {0.25f, 0, 0, 0, 0, -0.5f},
+        {0.25f, 0, 0, 0, 0, 0.5f},
+        {0.25f, 0, 0, 0, 0, -0.5f},
+        {0, 0, 0.25f, 0, 0, 0},
+        {0, 0, 0.25f, 0, 0, 0},
+        {0, 0, 0.25f, 0, 0, 0},
+        {0, 0, 0.25f, 0, 0, 0},
+};
+
+TEST(ThrustMixerTest, T200Curve) {
+    ThrustCurve curve = ThrustCurve::t200();
+    ASSERT_EQ(curve.pulseWidth(0), 1500);
+    ASSERT_EQ(curve.pulseWidth(51.5f), 1900);
+    ASSERT_EQ(curve.pulseWidth(-40.0f), 1100);
+    // Saturates beyond the measured range
+    ASSERT_EQ(curve.pulseWidth(1000.0f), 1900);
+    ASSERT_EQ(curve.pulseWidth(-1000.0f), 1100);
+    // Any real thrust is outside the deadband
+    ASSERT_GE(curve.pulseWidth(5.0f), 1590);
+    ASSERT_LE(curve.pulseWidth(-4.0f), 1410);
+    int previous = 0;
+    for (float force = -40.0f; force <= 51.5f; force += 0.5f) {
+        int pulseWidth = curve.pulseWidth(force);
+        ASSERT_GE(pulseWidth, previous);
+        previous = pulseWidth;
+    }
+}
+
+TEST(ThrustMixerTest, SmallForcesClearDeadband) {
+    ThrustCurve curve = ThrustCurve::t200();
+    ThrustMixer mixer(TEST_ALLOCATION, curve);
+    for (float force = 0.0001f; force < 1.0f; force *= 1.5f) {
+        ASSERT_GE(curve.pulseWidth(force), 1536) << force;
+        ASSERT_LE(curve.pulseWidth(-force), 1464) << force;
+
+        // Thruster 4 gets a quarter of the heave
+        pwm_array up = mixer.mix(Wrench{{0, 0, 4 * force, 0, 0, 0}});
+        pwm_array down = mixer.mix(Wrench{{0, 0, -4 * force, 0, 0, 0}});
+        ASSERT_GE(up.pwm_signals[4], 1536) << force;
+        ASSERT_LE(down.pwm_signals[4], 1464) << force;
+    }
+    ASSERT_EQ(curve.pulseWidth(0), 1500);
+}
+
+TEST(ThrustMixerTest, OneSidedCurve) {
+    ThrustMixer mixer(TEST_ALLOCATION, ThrustCurve::t200());
+    // A thruster that can only push forwards: asking it for reverse thrust must not scale the others to nothing
+    mixer.setCurve(4, ThrustCurve({{0, 1500}, {40.0f, 1900}}));
+    force_array forces{};
+    forces.forces[0] = 10;
+    forces.forces[4] = -10;
+    pwm_array pwms{};
+    float scale = mixer.forcesToPwm(forces, pwms);
+    ASSERT_FLOAT_EQ(scale, 1);
+    ASSERT_EQ(pwms.pwm_signals[0], ThrustCurve::t200().pulseWidth(10));
+    ASSERT_EQ(pwms.pwm_signals[4], 1500);
+    ASSERT_EQ(pwms.pwm_signals[1], 1500);
+}
+
+TEST(ThrustMixerTest, RoundsLikeCurve) {
+    ThrustMixer mixer(TEST_ALLOCATION, ThrustCurve::t200());
+    ThrustCurve curve = ThrustCurve::t200();
+    // Below saturation, every force must map to exactly the pulse width the curve gives it
+    for (int centinewtons = -3900; centinewtons <= 5100; centinewtons += 7) {
+        float force = (float) centinewtons / 100;
+        force_array forces{};
+        forces.forces[0] = force;
+        pwm_array pwms{};
+        mixer.forcesToPwm(forces, pwms);
+        ASSERT_EQ(pwms.pwm_signals[0], curve.pulseWidth(force)) << force;
+    }
+}
+
+TEST(ThrustMixerTest, MixesWrench) {
+    ThrustMixer mixer(TEST_ALLOCATION, ThrustCurve::t200());
+    pwm_array neutral = mixer.mix(Wrench{{0, 0, 0, 0, 0, 0}});
+    for (int pwm: neutral.pwm_signals) {
+        ASSERT_EQ(pwm, 1500);
+    }
+
+    force_array forces{};
+    mixer.allocate(Wrench{{40, 0, -20, 0, 0, 10}}, forces);
+    ASSERT_FLOAT_EQ(forces.forces[0], 15);
+    ASSERT_FLOAT_EQ(forces.forces[1], 5);
+    ASSERT_FLOAT_EQ(forces.forces[4], -5);
+
+    pwm_array pwms = mixer.mix(Wrench{{40, 0, -20, 0, 0, 10}});
+    ThrustCurve curve = ThrustCurve::t200();
+    ASSERT_EQ(pwms.pwm_signals[0], curve.pulseWidth(15));
+    ASSERT_EQ(pwms.pwm_signals[1], curve.pulseWidth(5));
+    ASSERT_EQ(pwms.pwm_signals[4], curve.pulseWidth(-5));
+}
+
+TEST(ThrustMixerTest, SaturationKeepsDirection) {
+    ThrustMixer mixer(TEST_ALLOCATION, ThrustCurve::t200());
+    // Thrusters 0 and 2 would need 103 N, twice what a T200 can give
+    force_array forces{};
+    mixer.allocate(Wrench{{206, 0, 0, 0, 0, 103}}, forces);
+    pwm_array pwms{};
+    float scale = mixer.forcesToPwm(forces, pwms);
+    ASSERT_FLOAT_EQ(scale, 2);
+    ThrustCurve curve = ThrustCurve::t200();
+    ASSERT_EQ(pwms.pwm_signals[0], 1900);
+    // The other horizontal thrusters are scaled by the same factor instead of saturating independently
+    ASSERT_EQ(pwms.pwm_signals[1], curve.pulseWidth(0));
+    ASSERT_EQ(pwms.pwm_signals[4], 1500);
+}
+
+TEST(ThrustMixerTest, PerThrusterCurves) {
+    ThrustMixer mixer(TEST_ALLOCATION, ThrustCurve::t200());
+    // A thruster mounted backwards: forward thrust needs a reverse pulse width
+    mixer.setCurve(3, ThrustCurve({{-51.5f, 1900}, {0, 1500}, {40.0f, 1100}}));
+    pwm_array pwms = mixer.mix(Wrench{{80, 0, 0, 0, 0, 0}});
+    ASSERT_GT(pwms.pwm_signals[0], 1500);
+    ASSERT_LT(pwms.pwm_signals[3], 1500);
+}
+
+TEST(ThrustMixerTest, MixIsFast) {
+    ThrustMixer mixer(TEST_ALLOCATION, ThrustCurve::t200());
+    const int iterations = 100000;
+    long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        pwm_array pwms = mixer.mix(Wrench{{(float) (i % 100), 0, 5, 0, 0, (float) (i % 7)}});
+        checksum += pwms.pwm_signals[i % 8];
+    }
+    auto perMix = (std::chrono::steady_clock::now() - start) / iterations;
+    ASSERT_GT(checksum, 0);
+    ASSERT_LT(perMix, std::chrono::microseconds(1));
+}
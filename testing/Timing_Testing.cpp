@@ -0,0 +1,51 @@
+#include "Timing.h"
+#include <gtest/gtest.h>
+#include <ctime>
+#include <thread>
+
+TEST(TimingTest, HybridWaitIsPreciseAndIdle) {
+    HybridWaitStrategy strategy;
+    CancellationToken cancellation;
+
+    std::clock_t cpuStart = std::clock();
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(strategy.wait(MonotonicClock::now() + std::chrono::milliseconds(20), cancellation));
+    }
+    double cpuSeconds = (double) (std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    WaitStatistics statistics = strategy.getStatistics();
+    ASSERT_EQ(statistics.waits, 10);
+    ASSERT_EQ(statistics.interrupted, 0);
+    ASSERT_LT(statistics.meanOvershoot(), std::chrono::milliseconds(1));
+    // 200 ms of waiting should cost only a small fraction of that in CPU time
+    ASSERT_LT(cpuSeconds, 0.05);
+}
+
+TEST(TimingTest, SleepWaitReachesDeadline) {
+    SleepWaitStrategy strategy;
+    CancellationToken cancellation;
+    auto deadline = MonotonicClock::now() + std::chrono::milliseconds(30);
+
+    ASSERT_TRUE(strategy.wait(deadline, cancellation));
+    ASSERT_GE(MonotonicClock::now(), deadline);
+    ASSERT_EQ(strategy.getStatistics().waits, 1);
+    ASSERT_LT(strategy.getStatistics().maxOvershoot, std::chrono::milliseconds(5));
+}
+
+TEST(TimingTest, WaitCanBeInterrupted) {
+    HybridWaitStrategy strategy;
+    CancellationToken cancellation;
+    auto start = MonotonicClock::now();
+
+    std::thread interrupter([&cancellation]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        cancellation.cancel();
+    });
+    bool completed = strategy.wait(start + std::chrono::seconds(5), cancellation);
+    interrupter.join();
+
+    ASSERT_FALSE(completed);
+    // The sleeping thread is woken by the cancellation itself, not by a later poll
+    ASSERT_LT(MonotonicClock::now() - cancellation.cancelledAt(), std::chrono::milliseconds(5));
+    ASSERT_EQ(strategy.getStatistics().interrupted, 1);
+}
@@ -0,0 +1,92 @@
+#include "Trace.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+
+/// @brief The thread id of the first span with the given name in a Chrome trace
+static std::string spanThread(const std::string &trace, const std::string &name) {
+    std::size_t span = trace.find("\"name\":\"" + name + "\"");
+    std::size_t tid = trace.find("\"tid\":", span);
+    return trace.substr(tid, trace.find(',', tid) - tid);
+}
+
+TEST(TraceTest, ExportsSpansFromEveryThread) {
+    clearTrace();
+    {
+        TraceSpan outer("outer span");
+        {
+            TraceSpan inner("inner \"quoted\" span");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    std::thread worker([]() { TraceSpan span("worker span"); });
+    worker.join();
+
+    std::ostringstream json;
+    writeChromeTrace(json);
+    std::string trace = json.str();
+    ASSERT_EQ(trace.find("{\"traceEvents\":["), 0);
+    ASSERT_NE(trace.find("\"name\":\"outer span\",\"ph\":\"X\""), std::string::npos);
+    ASSERT_NE(trace.find("\"name\":\"inner \\\"quoted\\\" span\""), std::string::npos);
+    ASSERT_NE(trace.find("\"name\":\"worker span\""), std::string::npos);
+    // The worker's span is on a different track
+    ASSERT_NE(spanThread(trace, "outer span"), spanThread(trace, "worker span"));
+    ASSERT_EQ(getDroppedTraceSpans(), 0);
+
+    clearTrace();
+    std::ostringstream empty;
+    writeChromeTrace(empty);
+    ASSERT_EQ(empty.str().find("span"), std::string::npos);
+}
+
+TEST(TraceTest, MacroCompilesOutWhenDisabled) {
+    clearTrace();
+    {
+        TRACE_SPAN("macro span");
+    }
+    std::ostringstream json;
+    writeChromeTrace(json);
+#ifdef TRACING
+    ASSERT_NE(json.str().find("macro span"), std::string::npos);
+#else
+    ASSERT_EQ(json.str().find("macro span"), std::string::npos);
+#endif
+}
+
+TEST(TraceTest, FinishedThreadsAreExportedOnce) {
+    clearTrace();
+    std::thread worker([]() { TraceSpan span("finished span"); });
+    worker.join();
+
+    std::ostringstream first;
+    writeChromeTrace(first);
+    ASSERT_NE(first.str().find("finished span"), std::string::npos);
+
+    // The finished thread's buffer is handed to the next thread instead of being kept for it
+    std::thread nextWorker([]() { TraceSpan span("next span"); });
+    nextWorker.join();
+    std::ostringstream second;
+    writeChromeTrace(second);
+    ASSERT_EQ(second.str().find("finished span"), std::string::npos);
+    ASSERT_NE(second.str().find("next span"), std::string::npos);
+}
+
+TEST(TraceTest, BufferCapacityIsConfigurable) {
+    clearTrace();
+    setTraceBufferCapacity(2);
+    std::thread worker([]() {
+        for (int i = 0; i < 3; i++) {
+            TraceSpan span("small buffer span");
+        }
+    });
+    worker.join();
+    setTraceBufferCapacity(TRACE_BUFFER_CAPACITY);
+
+    ASSERT_EQ(getDroppedTraceSpans(), 1);
+    std::ostringstream json;
+    writeChromeTrace(json);
+    ASSERT_EQ(getDroppedTraceSpans(), 1);
+    clearTrace();
+    ASSERT_EQ(getDroppedTraceSpans(), 0);
+}
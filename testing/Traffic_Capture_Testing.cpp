@@ -0,0 +1,157 @@
+#include "Traffic_Capture.h"
+#include "Wiring.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+TEST(TrafficCaptureTest, RoundTrip) {
+    std::stringstream sink;
+    std::string longFrame(600, 'x');
+    longFrame[599] = '\n';
+    {
+        TrafficCapture capture(sink);
+        capture.record(OutgoingTraffic, "Set 4 PWM 1600\n", 15);
+        capture.record(IncomingTraffic, "Set 4 PWM 1600\n", 15);
+        capture.record(OutgoingTraffic, longFrame.data(), longFrame.size());
+        capture.flush();
+        ASSERT_EQ(capture.getRecordedCount(OutgoingTraffic), 2);
+        ASSERT_EQ(capture.getRecordedCount(IncomingTraffic), 1);
+        ASSERT_EQ(capture.getDroppedCount(OutgoingTraffic), 0);
+    }
+
+    TrafficCaptureReader reader(sink);
+    ASSERT_TRUE(reader.isValid());
+    std::vector<TrafficFrame> frames;
+    TrafficFrame frame;
+    while (reader.next(frame)) {
+        frames.push_back(frame);
+    }
+    ASSERT_EQ(frames.size(), 3);
+    ASSERT_EQ(frames[0].direction, OutgoingTraffic);
+    ASSERT_EQ(frames[0].data, "Set 4 PWM 1600\n");
+    ASSERT_EQ(frames[1].direction, IncomingTraffic);
+    ASSERT_EQ(frames[2].data, longFrame);
+    ASSERT_GE(frames[0].timestamp, reader.header().monotonicStart);
+    ASSERT_LE(frames[0].timestamp, frames[1].timestamp);
+    ASSERT_LE(frames[1].timestamp, frames[2].timestamp);
+    std::string line = formatTrafficFrame(frames[0], reader.header());
+    ASSERT_NE(line.find("-> 15 bytes: Set 4 PWM 1600\\n"), std::string::npos);
+}
+
+TEST(TrafficCaptureTest, SplitFramesStayWholeWithConcurrentTraffic) {
+    std::stringstream sink;
+    const int frameCount = 2000;
+    long recordedOutgoing;
+    long recordedIncoming;
+    {
+        // Drain continuously, so the writer races the recorders as often as possible
+        TrafficCapture capture(sink, 64, std::chrono::milliseconds(0));
+        std::thread incoming([&capture]() {
+            for (int i = 0; i < frameCount; i++) {
+                capture.record(IncomingTraffic, "Ack 1\n", 6);
+            }
+        });
+        for (int i = 0; i < frameCount; i++) {
+            std::string frame(TRAFFIC_CHUNK_SIZE * 2 + 100, (char) ('a' + i % 26));
+            capture.record(OutgoingTraffic, frame.data(), frame.size());
+        }
+        incoming.join();
+        capture.flush();
+        recordedOutgoing = capture.getRecordedCount(OutgoingTraffic);
+        recordedIncoming = capture.getRecordedCount(IncomingTraffic);
+    }
+
+    TrafficCaptureReader reader(sink);
+    TrafficFrame frame;
+    long outgoingFrames = 0;
+    long incomingFrames = 0;
+    while (reader.next(frame)) {
+        if (frame.direction == OutgoingTraffic) {
+            ASSERT_EQ(frame.data, std::string(TRAFFIC_CHUNK_SIZE * 2 + 100, frame.data[0]));
+            outgoingFrames++;
+        } else {
+            ASSERT_EQ(frame.data, "Ack 1\n");
+            incomingFrames++;
+        }
+    }
+    ASSERT_GT(recordedOutgoing, 0);
+    ASSERT_EQ(outgoingFrames, recordedOutgoing);
+    ASSERT_EQ(incomingFrames, recordedIncoming);
+}
+
+TEST(TrafficCaptureTest, CapturesWiringTraffic) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    std::stringstream sink;
+    auto capture = std::make_shared<TrafficCapture>(sink);
+    WiringControl wiringControl(output, outLog, std::cerr);
+    wiringControl.setTrafficCapture(capture);
+    wiringControl.setPinType(4, HardwarePWM);
+    wiringControl.setWireProtocol(BinaryProtocol);
+    wiringControl.pwmWrite(4, 1600);
+
+    // Incoming traffic is recorded as it is read
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    SerialReader reader(fds[0], std::cerr);
+    reader.setTrafficCapture(capture);
+    ASSERT_EQ(write(fds[1], "Ack 3\n", 6), 6);
+    ASSERT_EQ(reader.poll(std::chrono::milliseconds(100)), 1);
+    close(fds[0]);
+    close(fds[1]);
+    capture->flush();
+
+    TrafficCaptureReader captureReader(sink);
+    ASSERT_TRUE(captureReader.isValid());
+    std::string outgoing;
+    std::string incoming;
+    long outgoingFrames = 0;
+    TrafficFrame frame;
+    while (captureReader.next(frame)) {
+        if (frame.direction == OutgoingTraffic) {
+            outgoing += frame.data;
+            outgoingFrames++;
+        } else {
+            incoming += frame.data;
+        }
+    }
+    ASSERT_EQ(outgoing, output.str());
+    ASSERT_EQ(outgoingFrames, 3);
+    ASSERT_EQ(incoming, "Ack 3\n");
+}
+
+TEST(TrafficCaptureTest, ReplaysOutgoingFrames) {
+    std::stringstream sink;
+    {
+        TrafficCapture capture(sink);
+        capture.record(OutgoingTraffic, "first\n", 6);
+        capture.record(IncomingTraffic, "echo\n", 5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        capture.record(OutgoingTraffic, "second\n", 7);
+        capture.flush();
+    }
+    std::string captured = sink.str();
+
+    for (bool realTime: {true, false}) {
+        std::stringstream input(captured);
+        TrafficCaptureReader reader(input);
+        std::vector<std::string> sent;
+        auto start = MonotonicClock::now();
+        long replayed = replayTraffic(reader, [&sent](const TrafficFrame &frame) { sent.push_back(frame.data); },
+                                      realTime);
+        auto elapsed = MonotonicClock::now() - start;
+
+        ASSERT_EQ(replayed, 2);
+        ASSERT_EQ(sent, (std::vector<std::string>{"first\n", "second\n"}));
+        if (realTime) {
+            ASSERT_GE(elapsed, std::chrono::milliseconds(29));
+            ASSERT_LT(elapsed, std::chrono::milliseconds(60));
+        } else {
+            ASSERT_LT(elapsed, std::chrono::milliseconds(10));
+        }
+    }
+}
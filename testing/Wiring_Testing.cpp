@@ -0,0 +1,275 @@
+#include "Wiring.h"
+#include <gtest/gtest.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+/// @brief Decode the records of the binary frame starting at the given offset
+/// @return The (pin, value) pairs of the frame, or an empty vector if the frame is malformed
+static std::vector<std::pair<int, int>> decodeFrame(const std::string &bytes, std::size_t offset, char frameType) {
+    auto data = reinterpret_cast<const uint8_t *>(bytes.data() + offset);
+    std::vector<std::pair<int, int>> records;
+    if (bytes.size() < offset + BINARY_FRAME_HEADER_SIZE || data[0] != BINARY_FRAME_SYNC ||
+        data[1] != (uint8_t) frameType) {
+        return records;
+    }
+    int count = data[3];
+    if (bytes.size() < offset + binaryFrameSize(count)) {
+        return records;
+    }
+    if (crc8(data + 1, binaryFrameSize(count) - 2) != data[binaryFrameSize(count) - 1]) {
+        return records;
+    }
+    for (int i = 0; i < count; i++) {
+        uint16_t record = (uint16_t) ((data[BINARY_FRAME_HEADER_SIZE + 2 * i] << 8) |
+                                      data[BINARY_FRAME_HEADER_SIZE + 2 * i + 1]);
+        records.emplace_back(binaryRecordPin(record), binaryRecordValue(record));
+    }
+    return records;
+}
+
+TEST(WiringTest, BinaryThrusterFrame) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+
+    auto pinNumbers = std::vector<int>{4, 5, 2, 3, 9, 7, 8, 6};
+    const int pwms[8] = {1900, 1900, 1100, 1250, 1300, 1464, 1535, 1536};
+    for (int pinNumber: pinNumbers) {
+        wiringControl.setPinType(pinNumber, HardwarePWM);
+    }
+    wiringControl.setWireProtocol(BinaryProtocol);
+    ASSERT_EQ(wiringControl.getWireProtocol(), BinaryProtocol);
+
+    output.str("");
+    wiringControl.pwmWriteFrame(pinNumbers.data(), pwms, 8);
+    std::string frame = output.str();
+
+    ASSERT_EQ(frame.size(), 21);
+    auto records = decodeFrame(frame, 0, PwmFrame);
+    ASSERT_EQ(records.size(), 8);
+    for (int i = 0; i < 8; i++) {
+        ASSERT_EQ(records[i].first, pinNumbers[i]);
+        ASSERT_EQ(records[i].second, pwms[i]);
+        ASSERT_EQ(wiringControl.pwmRead(pinNumbers[i]).pulseWidth, pwms[i]);
+    }
+
+    output.str("");
+    wiringControl.pwmWriteFrame(pinNumbers.data(), pwms, 8);
+    ASSERT_EQ((uint8_t) output.str()[2], (uint8_t) (frame[2] + 1));
+}
+
+TEST(WiringTest, BinaryMixedFrames) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+    wiringControl.setWireProtocol(BinaryProtocol);
+    output.str("");
+
+    wiringControl.setPinType(8, DigitalActiveLow);
+    std::string bytes = output.str();
+
+    auto configure = decodeFrame(bytes, 0, ConfigureFrame);
+    ASSERT_EQ(configure, (std::vector<std::pair<int, int>>{{8, DigitalActiveLow}}));
+    auto digital = decodeFrame(bytes, binaryFrameSize(1), DigitalFrame);
+    ASSERT_EQ(digital, (std::vector<std::pair<int, int>>{{8, High}}));
+    ASSERT_EQ(bytes.size(), 2 * binaryFrameSize(1));
+}
+
+TEST(WiringTest, BinaryValuesAreClamped) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    std::ostringstream errors;
+    WiringControl wiringControl = WiringControl(output, outLog, errors);
+    wiringControl.setPinType(4, HardwarePWM);
+    wiringControl.setPinType(5, HardwarePWM);
+    wiringControl.setWireProtocol(BinaryProtocol);
+
+    // 2548 would wrap to 500, sending the thruster the wrong way at almost full power
+    output.str("");
+    int pinNumbers[2] = {4, 5};
+    int pwms[2] = {2548, -1};
+    wiringControl.pwmWriteFrame(pinNumbers, pwms, 2);
+
+    auto records = decodeFrame(output.str(), 0, PwmFrame);
+    ASSERT_EQ(records, (std::vector<std::pair<int, int>>{{4, BINARY_RECORD_MAX_VALUE}, {5, 0}}));
+    ASSERT_NE(errors.str().find("Value 2548 for pin 4"), std::string::npos);
+    ASSERT_NE(errors.str().find("Value -1 for pin 5"), std::string::npos);
+}
+
+TEST(WiringTest, SwitchBackToAscii) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+    wiringControl.setPinType(4, HardwarePWM);
+
+    output.str("");
+    wiringControl.setWireProtocol(BinaryProtocol);
+    ASSERT_EQ(output.str(), "Protocol Binary\n");
+
+    output.str("");
+    wiringControl.setWireProtocol(AsciiProtocol);
+    auto records = decodeFrame(output.str(), 0, ProtocolFrame);
+    ASSERT_EQ(records, (std::vector<std::pair<int, int>>{{0, AsciiProtocol}}));
+
+    output.str("");
+    wiringControl.pwmWrite(4, 1700);
+    ASSERT_EQ(output.str(), "Set 4 PWM 1700\n");
+}
+
+TEST(WiringTest, ChangeOnlySuppressesUnchangedWrites) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+
+    auto pinNumbers = std::vector<int>{4, 5, 2};
+    int pwms[3] = {1500, 1500, 1500};
+    for (int pinNumber: pinNumbers) {
+        wiringControl.setPinType(pinNumber, HardwarePWM);
+    }
+    wiringControl.setPinType(8, DigitalActiveHigh);
+    wiringControl.setChangeOnly(true, 3);
+
+    output.str("");
+    wiringControl.pwmWriteFrame(pinNumbers.data(), pwms, 3);
+    ASSERT_EQ(output.str(), "");
+
+    output.str("");
+    pwms[1] = 1600;
+    wiringControl.pwmWriteFrame(pinNumbers.data(), pwms, 3);
+    ASSERT_EQ(output.str(), "Set 5 PWM 1600\n");
+    ASSERT_EQ(wiringControl.getSuppressedWriteCount(), 5);
+
+    // Third frame since enabling is a keyframe: the full cached state is sent once
+    output.str("");
+    pwms[0] = 1700;
+    wiringControl.pwmWriteFrame(pinNumbers.data(), pwms, 3);
+    ASSERT_EQ(output.str(), "Set 2 PWM 1500\nSet 4 PWM 1700\nSet 5 PWM 1600\nSet 8 Digital Low\n");
+
+    output.str("");
+    wiringControl.pwmWriteFrame(pinNumbers.data(), pwms, 3);
+    ASSERT_EQ(output.str(), "");
+    ASSERT_EQ(wiringControl.pwmRead(4).pulseWidth, 1700);
+}
+
+TEST(WiringTest, ChangeOnlyResendsAfterConfigure) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+    wiringControl.setChangeOnly(true, 0);
+
+    wiringControl.setPinType(4, HardwarePWM);
+    wiringControl.setPinType(4, HardwarePWM);
+    ASSERT_EQ(output.str(), "Configure 4 HardPwm\nSet 4 PWM 1500\nConfigure 4 HardPwm\nSet 4 PWM 1500\n");
+}
+
+TEST(WiringTest, PinStateTable) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+
+    PinStateTable empty = wiringControl.getPinStates();
+    for (int pinNumber = 0; pinNumber < PICO_GPIO_COUNT; pinNumber++) {
+        ASSERT_EQ(empty.types[pinNumber], Unconfigured);
+    }
+
+    wiringControl.setPinType(0, HardwarePWM);
+    wiringControl.setPinType(29, DigitalActiveLow);
+    wiringControl.pwmWrite(0, 1750);
+    PinStateTable snapshot = wiringControl.getPinStates();
+    wiringControl.pwmWrite(0, 1250);
+
+    ASSERT_EQ(snapshot.types[0], HardwarePWM);
+    ASSERT_EQ(snapshot.pwmStatuses[0].pulseWidth, 1750);
+    ASSERT_EQ(snapshot.types[29], DigitalActiveLow);
+    ASSERT_EQ(snapshot.digitalStatuses[29], High);
+    ASSERT_EQ(snapshot.types[1], Unconfigured);
+    ASSERT_EQ(wiringControl.pwmRead(0).pulseWidth, 1250);
+
+    // Reading an unconfigured pin does not configure it
+    ASSERT_EQ(wiringControl.pwmRead(5).pulseWidth, 0);
+    ASSERT_EQ(wiringControl.getPinStates().types[5], Unconfigured);
+}
+
+TEST(WiringDeathTest, RejectsInvalidPins) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+
+    ASSERT_EXIT(wiringControl.setPinType(30, HardwarePWM), testing::ExitedWithCode(42), "Invalid pin number 30");
+    ASSERT_EXIT(wiringControl.pwmRead(-1), testing::ExitedWithCode(42), "Invalid pin number -1");
+    ASSERT_EXIT(wiringControl.pwmWrite(3, 1500), testing::ExitedWithCode(42), "not been configured");
+}
+
+TEST(WiringTest, RoutesPinsToLinks) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    std::ostringstream linkOutput;
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+    ASSERT_EQ(wiringControl.addLink(std::make_shared<WiringControl>(linkOutput, outLog, std::cerr)), 1);
+    ASSERT_EQ(wiringControl.getLinkCount(), 2);
+
+    wiringControl.setPinType(4, HardwarePWM);
+    wiringControl.setPinType(34, HardwarePWM);
+    output.str("");
+    linkOutput.str("");
+
+    // A frame across both links is one write on each
+    int pinNumbers[2] = {4, 34};
+    int pwms[2] = {1600, 1700};
+    wiringControl.pwmWriteFrame(pinNumbers, pwms, 2);
+    ASSERT_EQ(output.str(), "Set 4 PWM 1600\n");
+    ASSERT_EQ(linkOutput.str(), "Set 4 PWM 1700\n");
+    ASSERT_EQ(wiringControl.pwmRead(4).pulseWidth, 1600);
+    ASSERT_EQ(wiringControl.pwmRead(34).pulseWidth, 1700);
+    ASSERT_EQ(wiringControl.getLink(1).pwmRead(4).pulseWidth, 1700);
+
+    // Settings and refreshes reach every link
+    wiringControl.setChangeOnly(true, 0);
+    wiringControl.pwmWriteFrame(pinNumbers, pwms, 2);
+    ASSERT_EQ(wiringControl.getSuppressedWriteCount(), 2);
+    output.str("");
+    linkOutput.str("");
+    wiringControl.refreshPins();
+    ASSERT_EQ(output.str(), "Set 4 PWM 1600\n");
+    ASSERT_EQ(linkOutput.str(), "Set 4 PWM 1700\n");
+}
+
+TEST(WiringDeathTest, RejectsPinsOnMissingLinks) {
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+    wiringControl.addLink(std::make_shared<WiringControl>(output, outLog, std::cerr));
+
+    ASSERT_EXIT(wiringControl.setPinType(60, HardwarePWM), testing::ExitedWithCode(42), "Invalid pin number 60");
+    ASSERT_EXIT(wiringControl.getLink(2), testing::ExitedWithCode(42), "no serial link 2");
+
+    wiringControl.beginFrame();
+    ASSERT_EQ(wiringControl.addLink(std::make_shared<WiringControl>(output, outLog, std::cerr)), -1);
+    wiringControl.endFrame();
+}
+
+TEST(WiringTest, AsciiEncodingMatchesToString) {
+    char buffer[DECIMAL_MAX_SIZE];
+    std::vector<int> values{INT32_MIN, INT32_MIN + 1, -1000000, -1, INT32_MAX, 1000000000, 999999999};
+    for (int value = -2100; value <= 2100; value++) {
+        values.push_back(value);
+    }
+    for (int value: values) {
+        ASSERT_EQ(std::string(buffer, formatDecimal(buffer, value)), std::to_string(value));
+    }
+
+    // Every ASCII message the wiring layer sends, byte for byte
+    AsciiMessage message;
+    message.text("Set ").number(29).text(" PWM ").number(1900).text("\n");
+    ASSERT_EQ(std::string(message.data(), message.size()), "Set 29 PWM 1900\n");
+    std::ofstream outLog("/dev/null");
+    std::ostringstream output;
+    WiringControl wiringControl = WiringControl(output, outLog, std::cerr);
+    wiringControl.setPinType(7, SoftwarePWM);
+    wiringControl.setPinType(12, DigitalActiveLow);
+    wiringControl.pwmWrite(7, 1100);
+    wiringControl.digitalWrite(12, Low);
+    ASSERT_EQ(output.str(), "Configure 7 SoftPwm\nSet 7 PWM 1500\nConfigure 12 Digital\nSet 12 Digital High\n"
+                            "Set 7 PWM 1100\nSet 12 Digital Low\n");
+}
@@ -0,0 +1,27 @@
+// Prints a binary event log (see lib/Event_Log.h) as text, one event per line.
+// Usage: log_decoder <log file>
+#include "Event_Log.h"
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <log file>" << std::endl;
+        return 1;
+    }
+    std::ifstream input(argv[1], std::ios::binary);
+    if (!input) {
+        std::cerr << "Could not open " << argv[1] << std::endl;
+        return 1;
+    }
+    EventLogHeader header{};
+    if (!readEventLogHeader(input, header)) {
+        std::cerr << argv[1] << " is not an event log" << std::endl;
+        return 1;
+    }
+    LogEvent event{};
+    while (input.read(reinterpret_cast<char *>(&event), sizeof(event))) {
+        std::cout << formatEvent(event, header) << '\n';
+    }
+    return 0;
+}
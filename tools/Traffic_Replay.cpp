@@ -0,0 +1,90 @@
+// Prints or replays a serial traffic capture (see lib/Traffic_Capture.h).
+// Usage: traffic_replay <capture file>                          print every frame as text
+//        traffic_replay <capture file> <device> [--fast]        send the outgoing frames to a device (e.g. the Pico
+//               [--baud <rate>]                                 or a simulator's pseudo-terminal), keeping their
+//                                                               original timing unless --fast is given
+#include "Serial_Connection.h"
+#include "Serial_Writer.h"
+#include "Traffic_Capture.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+#ifndef MOCK_RPI
+#include "Serial.h"
+#endif
+
+/// @brief Open the device to replay to, set up like the Pico's serial port
+/// @return The file descriptor, or -1 if the device could not be opened (-2 if the baud rate is not supported)
+static int openDevice(const char *device, int baud) {
+#ifdef MOCK_RPI
+    // Mock builds have no serial port code; the device (e.g. a simulator's pseudo-terminal) is written as it is
+    (void) baud;
+    return open(device, O_WRONLY | O_NOCTTY | O_CLOEXEC);
+#else
+    return serialOpen(device, baud);
+#endif
+}
+
+int main(int argc, char *argv[]) {
+    bool fast = false;
+    int baud = SerialConfig{}.baud;
+    bool validArguments = argc >= 2;
+    for (int i = 3; i < argc && validArguments; i++) {
+        std::string argument = argv[i];
+        if (argument == "--fast") {
+            fast = true;
+        } else if (argument == "--baud" && i + 1 < argc) {
+            baud = std::atoi(argv[++i]);
+        } else {
+            validArguments = false;
+        }
+    }
+    if (!validArguments) {
+        std::cerr << "Usage: " << argv[0] << " <capture file> [<device> [--fast] [--baud <rate>]]" << std::endl;
+        return 1;
+    }
+    std::ifstream input(argv[1], std::ios::binary);
+    if (!input) {
+        std::cerr << "Could not open " << argv[1] << std::endl;
+        return 1;
+    }
+    TrafficCaptureReader reader(input);
+    if (!reader.isValid()) {
+        std::cerr << argv[1] << " is not a traffic capture" << std::endl;
+        return 1;
+    }
+
+    if (argc == 2) {
+        TrafficFrame frame;
+        while (reader.next(frame)) {
+            std::cout << formatTrafficFrame(frame, reader.header()) << '\n';
+        }
+        return 0;
+    }
+
+    int fd = openDevice(argv[2], baud);
+    if (fd == -2) {
+        std::cerr << "Unsupported baud rate " << baud << std::endl;
+        return 1;
+    }
+    if (fd == -1) {
+        std::cerr << "Could not open " << argv[2] << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    bool failed = false;
+    long replayed = replayTraffic(reader, [fd, &failed](const TrafficFrame &frame) {
+        if (!failed && !writeFully(fd, frame.data.data(), frame.data.size())) {
+            std::cerr << "Error writing: " << std::strerror(errno) << std::endl;
+            failed = true;
+        }
+    }, !fast);
+    close(fd);
+    std::cerr << "Replayed " << replayed << " frames" << std::endl;
+    return failed ? 1 : 0;
+}